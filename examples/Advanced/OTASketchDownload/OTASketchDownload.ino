@@ -79,12 +79,13 @@ void handleSketchDownload() {
     Serial.println("There is not enough space to store the update. Can't continue with update.");
     return;
   }
-  byte b;
+  byte data[64];
   while (length > 0) {
-    if (!client.readBytes(&b, 1)) // reading a byte with timeout
+    int l = client.readBytes(data, min(length, (long) sizeof(data))); // reading with timeout
+    if (!l)
       break;
-    InternalStorage.write(b);
-    length--;
+    InternalStorage.write(data, l);
+    length -= l;
   }
   InternalStorage.close();
   client.stop();
@@ -89,12 +89,13 @@ void handleSketchDownload() {
     Serial.println("Could not create bin file. Can't continue with update.");
     return;
   }
-  byte b;
+  byte data[64];
   while (length > 0) {
-    if (!client.readBytes(&b, 1)) // reading a byte with timeout
+    int l = client.readBytes(data, min(length, (long) sizeof(data))); // reading with timeout
+    if (!l)
       break;
-    file.write(b);
-    length--;
+    file.write(data, l);
+    length -= l;
   }
   file.close();
   client.stop();
@@ -94,10 +94,8 @@ ihex_bool_t ihex_data_read(ihex_state *ihex, ihex_record_type_t type, ihex_bool_
     } else if (ihex->address > InternalStorage.maxSize()) {
       ihex2binError = 4;
     } else {
-      for (int i = 0; i < ihex->length; i++) {
-        InternalStorage.write(ihex->data[i]);
-        bytesWritten++;
-      }
+      InternalStorage.write(ihex->data, ihex->length);
+      bytesWritten += ihex->length;
     }
   } else if (type == IHEX_END_OF_FILE_RECORD) {
     InternalStorage.close();
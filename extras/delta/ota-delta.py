@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# Creates a patch for the delta update with the ArduinoOTA library.
+#
+#   ota-delta.py running.bin new.bin patch.bin [--offset N]
+#
+# running.bin must be the binary of the sketch running in the board.
+# With --offset, the patch creates the new binary from offset N,
+# for a resumed upload with Content-Range.
+#
+# Send the patch with headers 'Content-Encoding: x-ota-delta' and
+# 'X-OTA-Length: <size of new.bin - offset>'. Compressed with
+# 'heatshrink -e -w 8 -l 4' send it with 'Content-Encoding: x-ota-delta, heatshrink'.
+#
+# The patch format is described in src/utility/delta.h.
+
+import argparse
+import sys
+
+OP_DATA = 0
+OP_COPY = 1
+OP_ADD = 2
+
+KEY_LENGTH = 8  # the length of the indexed sequences
+MIN_MATCH = 12  # shorter matches are not worth a COPY
+MAX_CANDIDATES = 8
+
+
+def number(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def match_length(old, o, new, n):
+    limit = min(len(old) - o, len(new) - n)
+    length = 0
+    step = 64
+    while length < limit:
+        s = min(step, limit - length)
+        if old[o + length:o + length + s] == new[n + length:n + length + s]:
+            length += s
+            step = min(step * 2, 4096)
+        elif s == 1:
+            break
+        else:
+            step = s // 2
+    return length
+
+
+class Patch:
+
+    def __init__(self, old):
+        self.old = old
+        self.out = bytearray(b'OTAD')
+        self.out += number(len(old))
+        self.out += fnv1a(old).to_bytes(4, 'little')
+        self.copied = 0
+
+    def copy(self, offset, length):
+        self.out.append(OP_COPY)
+        self.out += number(length) + number(offset)
+        self.copied += length
+
+    # the bytes which don't match are sent as difference to the old bytes at
+    # the same shift as the last match (changed addresses and constants) or as data
+    def data(self, new, start, end, shift):
+        if start == end:
+            return
+        offset = start + shift if shift is not None else -1
+        if 0 <= offset and offset + end - start <= len(self.old):
+            old = self.old[offset:offset + end - start]
+            same = sum(1 for a, b in zip(old, new[start:end]) if a == b)
+            if same * 2 >= end - start:
+                self.out.append(OP_ADD)
+                self.out += number(end - start) + number(offset)
+                self.out += bytes((b - a) & 0xFF for a, b in zip(old, new[start:end]))
+                return
+        self.out.append(OP_DATA)
+        self.out += number(end - start)
+        self.out += new[start:end]
+
+
+def create_patch(old, new):
+    index = {}
+    for i in range(len(old) - KEY_LENGTH + 1):
+        positions = index.setdefault(old[i:i + KEY_LENGTH], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(i)
+
+    patch = Patch(old)
+    shift = None  # old offset - new offset of the last match
+    start = 0  # the start of not matched bytes
+    i = 0
+    while i < len(new):
+        candidates = index.get(new[i:i + KEY_LENGTH], [])
+        if shift is not None and 0 <= i + shift < len(old):
+            candidates = [i + shift] + candidates
+        best_offset = -1
+        best_length = 0
+        for offset in candidates:
+            length = match_length(old, offset, new, i)
+            if length > best_length:
+                best_offset = offset
+                best_length = length
+        if best_length < MIN_MATCH:
+            i += 1
+            continue
+        patch.data(new, start, i, shift)
+        patch.copy(best_offset, best_length)
+        shift = best_offset - i
+        i += best_length
+        start = i
+    patch.data(new, start, len(new), shift)
+    return patch
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Creates a patch for the ArduinoOTA delta update')
+    parser.add_argument('old', help='the binary of the running sketch')
+    parser.add_argument('new', help='the new binary')
+    parser.add_argument('patch', help='the output file')
+    parser.add_argument('--offset', type=int, default=0, help='start of the new binary for a resumed upload')
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+    if not 0 <= args.offset < len(new):
+        sys.exit('offset out of range')
+
+    patch = create_patch(old, new[args.offset:])
+    with open(args.patch, 'wb') as f:
+        f.write(patch.out)
+    print('patch size %d, X-OTA-Length: %d, copied %d bytes' % (len(patch.out), len(new) - args.offset, patch.copied))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+
+#include <atomic>
+
+static std::atomic<unsigned long long> now(0); // microseconds. the simulated tasks share the clock
+
+unsigned long millis()
+{
+  return now / 1000;
+}
+
+unsigned long micros()
+{
+  return now;
+}
+
+void delay(unsigned long ms)
+{
+  now += ms * 1000ULL;
+}
+
+void yield()
+{
+}
+
+void advanceMicros(unsigned long us)
+{
+  now += us;
+}
+
+__attribute__((weak))
+void NVIC_SystemReset()
+{
+  throw SimReset();
+}
+
+static unsigned long seed = 1;
+
+void randomSeed(unsigned long s)
+{
+  seed = s ? s : 1;
+}
+
+long random(long max)
+{
+  if (max <= 0)
+    return 0;
+  seed = seed * 1103515245UL + 12345UL; // the sequence is the same in every run
+  return (seed >> 8) % max;
+}
+
+long random(long min, long max)
+{
+  return (min >= max) ? min : min + random(max - min);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t n = 0;
+  while (n < size && write(buffer[n])) {
+    n++;
+  }
+  return n;
+}
+
+static size_t printNumber(Print& out, unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char* p = buf + sizeof(buf) - 1;
+  *p = 0;
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    int d = n % base;
+    *--p = (d < 10) ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n);
+  return out.write(p);
+}
+
+size_t Print::print(long n, int base)
+{
+  if (base == 10 && n < 0) {
+    return print('-') + printNumber(*this, -(unsigned long) n, 10);
+  }
+  return printNumber(*this, n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  return printNumber(*this, n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+class StdoutPrint : public Print {
+public:
+  virtual size_t write(uint8_t c) {
+    return fputc(c, stdout) == EOF ? 0 : 1;
+  }
+};
+
+static StdoutPrint stdoutPrint;
+Print& Serial = stdoutPrint;
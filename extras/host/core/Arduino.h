@@ -0,0 +1,88 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the part of the Arduino API used by the library, for the build on a host computer
+
+#ifndef _HOST_ARDUINO_H_INCLUDED
+#define _HOST_ARDUINO_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*) (p))
+#define pgm_read_word(p) (*(const uint16_t*) (p))
+#define pgm_read_dword(p) (*(const uint32_t*) (p))
+
+#define bit(b) (1UL << (b))
+
+template<class T, class L>
+auto min(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (b < a) ? b : a;
+}
+
+template<class T, class L>
+auto max(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (a < b) ? b : a;
+}
+
+// the time is simulated. it advances only with delay() and advanceMicros(),
+// so the results of a test don't depend on the speed of the host
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void advanceMicros(unsigned long us);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// thrown by the simulated resets. apply() doesn't return on the MCU
+struct SimReset {
+};
+
+// the CMSIS reset of the ARM MCUs. the models of the MCUs replace it to reset their state
+void NVIC_SystemReset();
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+extern Print& Serial;
+
+// the MCU headers included by the Arduino.h of the cores
+#if defined(ARDUINO_ARCH_RP2040)
+#include <RP2040Support.h>
+#elif defined(ARDUINO_ARCH_SAMD)
+#include <sam.h>
+#elif defined(ARDUINO_ARCH_STM32)
+#include <stm32_def.h>
+#endif
+
+#endif
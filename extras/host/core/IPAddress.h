@@ -0,0 +1,55 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_IPADDRESS_H_INCLUDED
+#define _HOST_IPADDRESS_H_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+
+// the address is stored in network byte order as in the Arduino API
+class IPAddress {
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+    bytes[0] = first;
+    bytes[1] = second;
+    bytes[2] = third;
+    bytes[3] = fourth;
+  }
+  IPAddress(uint32_t address) {
+    memcpy(bytes, &address, sizeof(bytes));
+  }
+
+  operator uint32_t() const {
+    uint32_t address;
+    memcpy(&address, bytes, sizeof(address));
+    return address;
+  }
+  bool operator==(const IPAddress& other) const {
+    return !memcmp(bytes, other.bytes, sizeof(bytes));
+  }
+  uint8_t operator[](int index) const {
+    return bytes[index];
+  }
+
+private:
+  uint8_t bytes[4];
+};
+
+#endif
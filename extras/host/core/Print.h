@@ -0,0 +1,80 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_PRINT_H_INCLUDED
+#define _HOST_PRINT_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* s) {
+    return s ? write((const uint8_t*) s, strlen(s)) : 0;
+  }
+  size_t write(const char* buffer, size_t size) {
+    return write((const uint8_t*) buffer, size);
+  }
+  virtual void flush() {}
+
+  size_t print(const char* s) {
+    return write(s);
+  }
+  size_t print(const String& s) {
+    return write(s.c_str());
+  }
+  size_t print(char c) {
+    return write((uint8_t) c);
+  }
+  size_t print(unsigned char n, int base = DEC) {
+    return print((unsigned long) n, base);
+  }
+  size_t print(int n, int base = DEC) {
+    return print((long) n, base);
+  }
+  size_t print(unsigned int n, int base = DEC) {
+    return print((unsigned long) n, base);
+  }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println() {
+    return write("\r\n");
+  }
+  template<class T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+  template<class T>
+  size_t println(const T& value, int format) {
+    return print(value, format) + println();
+  }
+};
+
+#endif
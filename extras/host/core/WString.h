@@ -0,0 +1,93 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_WSTRING_H_INCLUDED
+#define _HOST_WSTRING_H_INCLUDED
+
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s(s ? s : "") {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+
+  unsigned int length() const {
+    return s.length();
+  }
+  const char* c_str() const {
+    return s.c_str();
+  }
+  char charAt(unsigned int index) const {
+    return (index < s.length()) ? s[index] : 0;
+  }
+  char operator[](unsigned int index) const {
+    return charAt(index);
+  }
+  bool reserve(unsigned int size) {
+    s.reserve(size);
+    return true;
+  }
+  bool equals(const String& other) const {
+    return s == other.s;
+  }
+  bool operator==(const String& other) const {
+    return s == other.s;
+  }
+  bool operator!=(const String& other) const {
+    return s != other.s;
+  }
+
+  String& operator+=(const String& other) {
+    s += other.s;
+    return *this;
+  }
+  String& operator+=(const char* other) {
+    s += other;
+    return *this;
+  }
+  String& operator+=(char c) {
+    s += c;
+    return *this;
+  }
+
+  friend String operator+(const String& a, const String& b) {
+    String r(a);
+    r += b;
+    return r;
+  }
+  friend String operator+(const char* a, const String& b) {
+    String r(a);
+    r += b;
+    return r;
+  }
+  friend String operator+(const String& a, const char* b) {
+    String r(a);
+    r += b;
+    return r;
+  }
+
+private:
+  std::string s;
+};
+
+#endif
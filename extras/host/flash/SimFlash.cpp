@@ -0,0 +1,255 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimFlash.h"
+
+#include <sys/mman.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+SimFlash::SimFlash(uint32_t base, uint32_t size, std::initializer_list<uint32_t> eraseUnits, uint32_t programSize,
+    unsigned long eraseMicros, unsigned long programMicros) :
+  base(base), size(size), programSize(programSize),
+  eraseMicros(eraseMicros), programMicros(programMicros), hostEraseMicros(0),
+  largestUnit(0), trapping(false)
+{
+  void* p = mmap((void*) (uintptr_t) base, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if (p != (void*) (uintptr_t) base) {
+    fprintf(stderr, "the simulated flash can't be mapped at 0x%x: %s\n", base, strerror(errno));
+    exit(1);
+  }
+  uint32_t start = 0;
+  uint32_t unit = 0;
+  for (uint32_t u : eraseUnits) {
+    if (start >= size)
+      break;
+    unitStarts.push_back(start);
+    start += u;
+    unit = u;
+    largestUnit = max(largestUnit, u);
+  }
+  while (start < size) {
+    unitStarts.push_back(start);
+    start += unit;
+  }
+  unitStarts.push_back(size);
+  wear.resize(units());
+  reset();
+}
+
+SimFlash::~SimFlash()
+{
+  munmap((void*) (uintptr_t) base, size);
+}
+
+void SimFlash::reset()
+{
+  unprotect();
+  memset((void*) (uintptr_t) base, 0xFF, size);
+  protect();
+  erases = 0;
+  programs = 0;
+  std::fill(wear.begin(), wear.end(), 0);
+  errors = 0;
+  lastError[0] = 0;
+  resets = 0;
+}
+
+void SimFlash::load(uint32_t offset, const uint8_t* data, size_t size)
+{
+  unprotect();
+  memcpy((uint8_t*) (uintptr_t) base + offset, data, size);
+  protect();
+}
+
+size_t SimFlash::unitAt(uint32_t offset) const
+{
+  size_t unit = 0;
+  while (unit < units() - 1 && unitStarts[unit + 1] <= offset) {
+    unit++;
+  }
+  return unit;
+}
+
+uint16_t SimFlash::maxWear() const
+{
+  uint16_t m = 0;
+  for (uint16_t w : wear) {
+    m = max(m, w);
+  }
+  return m;
+}
+
+void SimFlash::error(const char* format, uint32_t offset)
+{
+  errors++;
+  snprintf(lastError, sizeof(lastError), format, offset);
+  fprintf(stderr, "flash: %s\n", lastError);
+}
+
+bool SimFlash::erase(uint32_t offset, uint32_t count)
+{
+  if (offset + count > size || offset + count < offset) {
+    error("erase at 0x%x exceeds the flash", offset);
+    return false;
+  }
+  size_t first = unitAt(offset);
+  size_t last = unitAt(offset + count - 1);
+  if (!count || unitStart(first) != offset || unitStart(last) + unitSize(last) != offset + count) {
+    error("erase at 0x%x not aligned to an erase unit", offset);
+    return false;
+  }
+  unprotect();
+  memset((uint8_t*) (uintptr_t) base + offset, 0xFF, count);
+  protect();
+  for (size_t unit = first; unit <= last; unit++) {
+    wear[unit]++;
+    erases++;
+    advanceMicros((unsigned long long) eraseMicros * unitSize(unit) / largestUnit);
+    if (hostEraseMicros) {
+      std::this_thread::sleep_for(std::chrono::microseconds(hostEraseMicros));
+    }
+  }
+  return true;
+}
+
+bool SimFlash::program(uint32_t offset, const uint8_t* data, uint32_t count)
+{
+  if (offset % programSize || count % programSize) {
+    error("program at 0x%x not aligned to a program unit", offset);
+    return false;
+  }
+  if (offset + count > size || offset + count < offset) {
+    error("program at 0x%x exceeds the flash", offset);
+    return false;
+  }
+  uint8_t* p = (uint8_t*) (uintptr_t) base + offset;
+  for (uint32_t i = 0; i < count; i++) {
+    if (p[i] != 0xFF) {
+      error("program of 0x%x, which is not erased", offset + i);
+      break;
+    }
+  }
+  unprotect();
+  for (uint32_t i = 0; i < count; i++) {
+    p[i] &= data[i]; // programming only clears bits
+  }
+  protect();
+  programs += count / programSize;
+  advanceMicros(count / programSize * programMicros);
+  return true;
+}
+
+// the trap of the stores into the flash memory. the first store to a host page
+// saves the page and makes it writable until takeStores()
+
+static const size_t MAX_TRAPPED_PAGES = 16;
+
+struct TrappedPage {
+  uintptr_t page;
+  uintptr_t store;
+};
+
+static SimFlash* trappingFlash;
+static uintptr_t hostPageSize;
+static TrappedPage trappedPages[MAX_TRAPPED_PAGES];
+static uint8_t* savedPages; // the content of the trapped pages before the stores
+static volatile size_t trappedCount;
+
+static void trapStore(int sig, siginfo_t* info, void*)
+{
+  uintptr_t a = (uintptr_t) info->si_addr;
+  const SimFlash* flash = trappingFlash;
+  if (!flash || a < flash->base || a >= flash->base + flash->size || trappedCount == MAX_TRAPPED_PAGES) {
+    signal(sig, SIG_DFL); // a crash. it faults again with the default action
+    return;
+  }
+  size_t i = trappedCount;
+  uintptr_t page = a & ~(hostPageSize - 1);
+  trappedPages[i].page = page;
+  trappedPages[i].store = a;
+  memcpy(savedPages + i * hostPageSize, (const void*) page, hostPageSize);
+  mprotect((void*) page, hostPageSize, PROT_READ | PROT_WRITE);
+  trappedCount = i + 1;
+}
+
+void SimFlash::trapStores()
+{
+  hostPageSize = sysconf(_SC_PAGESIZE);
+  savedPages = new uint8_t[MAX_TRAPPED_PAGES * hostPageSize];
+  trappingFlash = this;
+  trapping = true;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = trapStore;
+  action.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigaction(SIGSEGV, &action, nullptr);
+  protect();
+}
+
+void SimFlash::takeStores(uint32_t width, const std::function<void(uint32_t offset, const uint8_t* data)>& store)
+{
+  std::atomic_signal_fence(std::memory_order_seq_cst); // the pages were trapped by the signal handler
+  std::vector<uint32_t> offsets;
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < trappedCount; i++) {
+    uint8_t* page = (uint8_t*) trappedPages[i].page;
+    uint8_t* saved = savedPages + i * hostPageSize;
+    uintptr_t storeUnit = trappedPages[i].store & ~(uintptr_t) (width - 1);
+    for (uint32_t j = 0; j < hostPageSize; j += width) {
+      if ((uintptr_t) (page + j) == storeUnit || memcmp(page + j, saved + j, width)) {
+        offsets.push_back((uintptr_t) (page + j) - base);
+        data.insert(data.end(), page + j, page + j + width);
+      }
+    }
+    memcpy(page, saved, hostPageSize);
+  }
+  trappedCount = 0;
+  protect();
+  for (size_t i = 0; i < offsets.size(); i++) {
+    store(offsets[i], data.data() + i * width);
+  }
+}
+
+// the simulation itself writes to the memory of the flash between unprotect() and protect().
+// the stores not taken by the model of the flash controller until then are lost
+void SimFlash::unprotect()
+{
+  if (!trapping)
+    return;
+  if (trappedCount) {
+    error("store to 0x%x not taken by the flash controller", trappedPages[0].store - base);
+    for (size_t i = 0; i < trappedCount; i++) {
+      memcpy((void*) trappedPages[i].page, savedPages + i * hostPageSize, hostPageSize);
+    }
+    trappedCount = 0;
+  }
+  mprotect((void*) (uintptr_t) base, size, PROT_READ | PROT_WRITE);
+}
+
+void SimFlash::protect()
+{
+  if (trapping) {
+    mprotect((void*) (uintptr_t) base, size, PROT_READ);
+  }
+}
@@ -0,0 +1,105 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _SIM_FLASH_H_INCLUDED
+#define _SIM_FLASH_H_INCLUDED
+
+#include <Arduino.h>
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+// a simulated flash mapped at its address on the MCU with mmap of Linux. it counts
+// the erased units and the programmed units, adds their typical time to the simulated
+// clock and records the misuse, which would fail or corrupt the flash on the MCU.
+// the models of the flash controllers of the MCUs call erase() and program()
+class SimFlash {
+public:
+  // `eraseUnits` are the sizes of the erase units (sectors, rows, blocks or pages) from
+  // the start of the flash. the last of them repeats to the end of the flash. program()
+  // writes whole multiples of `programSize`. `eraseMicros` is the time of an erase of
+  // the largest unit, smaller units take proportionally less
+  SimFlash(uint32_t base, uint32_t size, std::initializer_list<uint32_t> eraseUnits, uint32_t programSize,
+      unsigned long eraseMicros, unsigned long programMicros);
+  ~SimFlash();
+
+  const uint32_t base;
+  const uint32_t size;
+  const uint32_t programSize;
+
+  // erases the whole flash and resets the counters
+  void reset();
+  // writes data to the flash without counting, for example the running sketch
+  void load(uint32_t offset, const uint8_t* data, size_t size);
+  const uint8_t* memory() const {
+    return (const uint8_t*) (uintptr_t) base;
+  }
+
+  // the erase units. offsets are from the base
+  size_t units() const {
+    return unitStarts.size() - 1;
+  }
+  uint32_t unitStart(size_t unit) const {
+    return unitStarts[unit];
+  }
+  uint32_t unitSize(size_t unit) const {
+    return unitStarts[unit + 1] - unitStarts[unit];
+  }
+  size_t unitAt(uint32_t offset) const;
+
+  unsigned long erases; // of erase units
+  unsigned long programs; // of program units
+  std::vector<uint16_t> wear; // the count of erases of every erase unit
+  uint16_t maxWear() const;
+  unsigned long errors;
+  char lastError[80];
+  unsigned long resets;
+
+  unsigned long eraseMicros; // of the largest erase unit
+  unsigned long programMicros; // of a program unit
+  // the real time an erase of a unit blocks the calling thread. the other
+  // simulated tasks run meanwhile as on a MCU with a busy flash
+  unsigned long hostEraseMicros;
+
+  // erases whole units and programs whole program units at offsets from the base.
+  // they return false for a misuse, which the flash controller would refuse
+  bool erase(uint32_t offset, uint32_t count);
+  bool program(uint32_t offset, const uint8_t* data, uint32_t count);
+  void error(const char* format, uint32_t offset);
+
+  // the memory of the flash gets read-only for the code. the stores of the code,
+  // which go to the flash controller on the MCU, are trapped
+  void trapStores();
+  // calls `store` with the offset and the data of every unit of `width` bytes stored
+  // since the last call. the memory gets its previous content back. a store is seen by
+  // its address if it is the first to its host page, else by the changed content
+  void takeStores(uint32_t width, const std::function<void(uint32_t offset, const uint8_t* data)>& store);
+
+private:
+  std::vector<uint32_t> unitStarts;
+  uint32_t largestUnit;
+  bool trapping;
+
+  void unprotect();
+  void protect();
+};
+
+extern SimFlash simFlash;
+
+#endif
@@ -0,0 +1,137 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "task.h"
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SimTask {
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notifications;
+  bool deleted;
+};
+
+// thrown in a task which ends without a reset
+struct SimTaskEnd {
+};
+
+static std::mutex tasksMutex;
+static std::condition_variable tasksEnded;
+static std::vector<SimTask*> tasks;
+static unsigned running;
+static bool resetDone;
+
+static thread_local SimTask* currentTask;
+
+static void stop(SimTask* task)
+{
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->deleted = true;
+  task->notified.notify_one();
+}
+
+static void run(SimTask* task, TaskFunction_t fn, void* arg)
+{
+  currentTask = task;
+  bool reset = false;
+  try {
+    fn(arg); // a task function of FreeRTOS doesn't return
+  } catch (SimReset&) {
+    reset = true;
+  } catch (SimTaskEnd&) {
+  }
+  std::lock_guard<std::mutex> lock(tasksMutex);
+  if (reset) { // the reset ends all tasks
+    resetDone = true;
+    for (SimTask* t : tasks) {
+      stop(t);
+    }
+  }
+  running--;
+  tasksEnded.notify_all();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle)
+{
+  SimTask* task = new SimTask();
+  task->notifications = 0;
+  task->deleted = false;
+  std::lock_guard<std::mutex> lock(tasksMutex);
+  tasks.push_back(task);
+  running++;
+  task->thread = std::thread(run, task, fn, arg);
+  if (handle) {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+void vTaskCoreAffinitySet(TaskHandle_t, UBaseType_t)
+{
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  if (!task || task == currentTask)
+    throw SimTaskEnd();
+  stop(task);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->notifications++;
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t)
+{
+  SimTask* task = currentTask;
+  std::unique_lock<std::mutex> lock(task->mutex);
+  task->notified.wait(lock, [task] {return task->notifications > 0 || task->deleted;});
+  if (task->deleted)
+    throw SimTaskEnd();
+  uint32_t n = task->notifications;
+  task->notifications = clearOnExit ? 0 : n - 1;
+  return n;
+}
+
+void simTasksWait(unsigned seconds)
+{
+  std::unique_lock<std::mutex> lock(tasksMutex);
+  if (!tasksEnded.wait_for(lock, std::chrono::seconds(seconds), [] {return resetDone && !running;})) {
+    fprintf(stderr, "the simulated tasks didn't reset the board in %u s\n", seconds);
+    fflush(stdout);
+    _Exit(1);
+  }
+  for (SimTask* task : tasks) {
+    task->thread.join();
+    delete task;
+  }
+  tasks.clear();
+  resetDone = false;
+}
@@ -0,0 +1,41 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_TASK_H_INCLUDED
+#define _HOST_TASK_H_INCLUDED
+
+// the FreeRTOS tasks are simulated with threads of the host. they run in parallel,
+// so the host thread sanitizer checks the data shared by the tasks
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct SimTask* TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg, UBaseType_t priority, TaskHandle_t* handle);
+void vTaskCoreAffinitySet(TaskHandle_t task, UBaseType_t coreMask);
+void vTaskDelete(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+
+// waits up to `seconds` of real time until a task resets the board and the other tasks
+// end in their next ulTaskNotifyTake(). the running tasks can't be stopped, so the test
+// process exits with a failure if there is no reset in time
+void simTasksWait(unsigned seconds);
+
+#endif
@@ -0,0 +1,272 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimNet.h"
+
+SimNetwork simNetwork;
+
+std::shared_ptr<SimConnection> SimNetwork::connect(const std::string& request)
+{
+  std::shared_ptr<SimConnection> c = std::make_shared<SimConnection>();
+  c->request = request;
+  c->start = micros();
+  pending.push_back(c);
+  return c;
+}
+
+size_t SimConnection::arrived() const
+{
+  size_t end = min(request.size(), closeAt);
+  unsigned long long t = micros() - start;
+  size_t n = 0;
+  for (const SimStall& stall : stalls) {
+    if (stall.offset >= end)
+      break;
+    unsigned long long d = bytesPerSecond ? (stall.offset - n) * 1000000ULL / bytesPerSecond : 0;
+    if (t < d)
+      return n + t * bytesPerSecond / 1000000;
+    t -= d;
+    n = stall.offset;
+    if (t < stall.ms * 1000ULL)
+      return n;
+    t -= stall.ms * 1000ULL;
+  }
+  if (bytesPerSecond && t * bytesPerSecond / 1000000 < end - n)
+    return n + t * bytesPerSecond / 1000000;
+  return end;
+}
+
+int SimClient::connect(IPAddress, uint16_t)
+{
+  return 0;
+}
+
+int SimClient::connect(const char*, uint16_t)
+{
+  return 0;
+}
+
+size_t SimClient::write(uint8_t b)
+{
+  return write(&b, 1);
+}
+
+size_t SimClient::write(const uint8_t* buffer, size_t size)
+{
+  if (!connection || connection->stopped)
+    return 0;
+  advanceMicros(connection->callMicros);
+  connection->response.append((const char*) buffer, size);
+  return size;
+}
+
+int SimClient::available()
+{
+  if (!connection || connection->stopped)
+    return 0;
+  advanceMicros(connection->callMicros);
+  int n = connection->arrived() - connection->readIndex;
+  if (n == 0) {
+    connection->spins++;
+  }
+  return n;
+}
+
+int SimClient::read()
+{
+  uint8_t b;
+  return (read(&b, 1) == 1) ? b : -1;
+}
+
+int SimClient::read(uint8_t* buffer, size_t size)
+{
+  if (!connection || connection->stopped)
+    return -1;
+  advanceMicros(connection->callMicros);
+  size_t l = min(min(size, connection->nextSegment()), connection->arrived() - connection->readIndex);
+  if (l == 0)
+    return -1;
+  memcpy(buffer, connection->request.data() + connection->readIndex, l);
+  connection->readIndex += l;
+  connection->reads++;
+  return l;
+}
+
+int SimClient::peek()
+{
+  if (!connection || connection->stopped || connection->readIndex == connection->arrived())
+    return -1;
+  return (uint8_t) connection->request[connection->readIndex];
+}
+
+void SimClient::flush()
+{
+  if (connection) {
+    connection->flushed = true;
+    connection->flushedAt = micros();
+  }
+}
+
+void SimClient::stop()
+{
+  if (connection) {
+    connection->stopped = true;
+  }
+}
+
+uint8_t SimClient::connected()
+{
+  if (!connection || connection->stopped)
+    return false;
+  advanceMicros(connection->callMicros);
+  return connection->peerOpen();
+}
+
+SimClient::operator bool()
+{
+  return connection && !connection->stopped;
+}
+
+SimServer::SimServer(uint16_t _port) : port(_port)
+{
+}
+
+void SimServer::begin()
+{
+  simNetwork.serverPort = port;
+}
+
+void SimServer::stop()
+{
+  simNetwork.serverPort = 0;
+  simNetwork.pending.clear();
+}
+
+SimClient SimServer::available()
+{
+  if (!simNetwork.serverPort || simNetwork.pending.empty())
+    return SimClient();
+  SimClient client(simNetwork.pending.front());
+  simNetwork.pending.pop_front();
+  return client;
+}
+
+size_t SimServer::write(uint8_t)
+{
+  return 0;
+}
+
+uint8_t SimUDP::begin(uint16_t)
+{
+  simNetwork.udpOpen = true;
+  return 1;
+}
+
+uint8_t SimUDP::beginMulticast(IPAddress, uint16_t)
+{
+  simNetwork.udpOpen = true;
+  return 1;
+}
+
+void SimUDP::stop()
+{
+  simNetwork.udpOpen = false;
+}
+
+int SimUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+  out.ip = ip;
+  out.port = port;
+  out.data.clear();
+  return 1;
+}
+
+int SimUDP::beginPacket(const char*, uint16_t)
+{
+  return 0;
+}
+
+int SimUDP::endPacket()
+{
+  simNetwork.sent.push_back(out);
+  return 1;
+}
+
+size_t SimUDP::write(uint8_t b)
+{
+  out.data += (char) b;
+  return 1;
+}
+
+size_t SimUDP::write(const uint8_t* buffer, size_t size)
+{
+  out.data.append((const char*) buffer, size);
+  return size;
+}
+
+int SimUDP::parsePacket()
+{
+  if (!simNetwork.udpOpen || simNetwork.received.empty())
+    return 0;
+  in = simNetwork.received.front();
+  simNetwork.received.pop_front();
+  readIndex = 0;
+  return in.data.size();
+}
+
+int SimUDP::available()
+{
+  return in.data.size() - readIndex;
+}
+
+int SimUDP::read()
+{
+  return (readIndex < in.data.size()) ? (uint8_t) in.data[readIndex++] : -1;
+}
+
+int SimUDP::read(unsigned char* buffer, size_t len)
+{
+  size_t l = min(len, in.data.size() - readIndex);
+  memcpy(buffer, in.data.data() + readIndex, l);
+  readIndex += l;
+  return l;
+}
+
+int SimUDP::read(char* buffer, size_t len)
+{
+  return read((unsigned char*) buffer, len);
+}
+
+int SimUDP::peek()
+{
+  return (readIndex < in.data.size()) ? (uint8_t) in.data[readIndex] : -1;
+}
+
+void SimUDP::flush()
+{
+}
+
+IPAddress SimUDP::remoteIP()
+{
+  return in.ip;
+}
+
+uint16_t SimUDP::remotePort()
+{
+  return in.port;
+}
@@ -0,0 +1,163 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _SIM_NET_H_INCLUDED
+#define _SIM_NET_H_INCLUDED
+
+#include <Arduino.h>
+#include <Client.h>
+#include <Server.h>
+#include <Udp.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// no data arrive for ms after offset bytes of the request
+struct SimStall {
+  size_t offset;
+  unsigned long ms;
+};
+
+// a TCP connection from the uploader to the board. the request is sent whole
+// and the uploader closes the connection after it reads the response
+struct SimConnection {
+  std::string request;
+  size_t readIndex = 0; // of the request
+  size_t segmentSize = 1460; // the most bytes returned by one read
+  bool closeAfterRequest = false; // the uploader doesn't wait for the response
+  unsigned long closeDelay = 0; // ms after the response until the uploader closes the connection
+  std::string response;
+  bool flushed = false; // the response was sent
+  unsigned long flushedAt = 0; // micros()
+  bool stopped = false; // by the board
+
+  // impairments of the link
+  std::vector<size_t> segments; // the most bytes returned by the reads in turn, instead of segmentSize
+  unsigned long bytesPerSecond = 0; // the data arrive at this rate. 0 is all at once
+  std::vector<SimStall> stalls; // ordered by offset
+  size_t closeAt = std::string::npos; // the uploader closes the connection after sending this count of bytes
+
+  unsigned long start = 0; // micros() at connect
+  unsigned long callMicros = 10; // a call of the network library takes simulated time
+  unsigned long reads = 0; // the calls of read which returned data
+  unsigned long spins = 0; // the calls of available which returned 0
+
+  size_t arrived() const; // the count of bytes of the request received by the board
+  size_t nextSegment() const {
+    return segments.empty() ? segmentSize : segments[reads % segments.size()];
+  }
+  bool peerOpen() const {
+    if (closeAt < request.size())
+      return readIndex < closeAt;
+    return readIndex < request.size() || !((flushed && micros() - flushedAt >= closeDelay * 1000) || closeAfterRequest);
+  }
+  int responseCode() const {
+    return (response.compare(0, 9, "HTTP/1.1 ") == 0) ? atoi(response.c_str() + 9) : 0;
+  }
+};
+
+class SimClient : public Client {
+public:
+  SimClient() {}
+  SimClient(std::shared_ptr<SimConnection> c) : connection(c) {}
+
+  virtual int connect(IPAddress ip, uint16_t port);
+  virtual int connect(const char* host, uint16_t port);
+  virtual size_t write(uint8_t b);
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  virtual int available();
+  virtual int read();
+  virtual int read(uint8_t* buffer, size_t size);
+  virtual int peek();
+  virtual void flush();
+  virtual void stop();
+  virtual uint8_t connected();
+  virtual operator bool();
+
+  using Print::write;
+
+private:
+  std::shared_ptr<SimConnection> connection;
+};
+
+class SimServer : public Server {
+public:
+  SimServer(uint16_t port);
+
+  virtual void begin();
+  void stop();
+  SimClient available();
+  virtual size_t write(uint8_t b);
+
+  using Print::write;
+
+private:
+  uint16_t port;
+};
+
+struct SimPacket {
+  IPAddress ip;
+  uint16_t port;
+  std::string data;
+};
+
+class SimUDP : public UDP {
+public:
+  virtual uint8_t begin(uint16_t port);
+  virtual uint8_t beginMulticast(IPAddress ip, uint16_t port);
+  virtual void stop();
+  virtual int beginPacket(IPAddress ip, uint16_t port);
+  virtual int beginPacket(const char* host, uint16_t port);
+  virtual int endPacket();
+  virtual size_t write(uint8_t b);
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  virtual int parsePacket();
+  virtual int available();
+  virtual int read();
+  virtual int read(unsigned char* buffer, size_t len);
+  virtual int read(char* buffer, size_t len);
+  virtual int peek();
+  virtual void flush();
+  virtual IPAddress remoteIP();
+  virtual uint16_t remotePort();
+
+  using Print::write;
+
+private:
+  SimPacket in;
+  size_t readIndex = 0;
+  SimPacket out;
+};
+
+// the network seen by the board. the tests queue the connections and the packets
+class SimNetwork {
+public:
+  std::shared_ptr<SimConnection> connect(const std::string& request);
+
+  uint16_t serverPort = 0; // 0 if the server isn't listening
+  std::deque<std::shared_ptr<SimConnection>> pending;
+  bool udpOpen = false;
+  std::deque<SimPacket> received; // by the board
+  std::vector<SimPacket> sent; // by the board
+};
+
+extern SimNetwork simNetwork;
+
+#endif
@@ -0,0 +1,152 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimFlash.h"
+
+#include <RP2040Support.h>
+#include <hardware/flash.h>
+#include <pico/bootrom.h>
+#include <hardware/watchdog.h>
+
+// the end of the sketch area (MAX_FLASH) in the linker script of the Pico core
+__asm__(".globl _FS_start\n .set _FS_start, 0x101ff000\n"
+        ".globl _EEPROM_start\n .set _EEPROM_start, 0x101ff000\n");
+
+// the 2 MB QSPI flash of a Pico without file system. the last sector is the EEPROM.
+// the flash is mapped before the static objects of the library are constructed
+SimFlash simFlash __attribute__((init_priority(101))) (XIP_BASE, 2 * 1024 * 1024, {FLASH_SECTOR_SIZE}, FLASH_PAGE_SIZE, 45000, 800);
+RP2040 rp2040;
+
+// the state of the MCU checked by the flash operations
+static bool otherCoreIdle = false;
+static bool xipActive = true;
+
+// the SDK functions leave the XIP mode themselves. the ROM functions
+// used by the RAM copier need the XIP mode exited before them
+static void erase(uint32_t offset, size_t count, bool rom)
+{
+  if (rom ? xipActive : !otherCoreIdle) {
+    simFlash.error(rom ? "erase at 0x%x in XIP mode" : "erase at 0x%x while the other core runs", offset);
+  }
+  simFlash.erase(offset, count);
+}
+
+static void program(uint32_t offset, const uint8_t* data, size_t count, bool rom)
+{
+  if (rom ? xipActive : !otherCoreIdle) {
+    simFlash.error(rom ? "program at 0x%x in XIP mode" : "program at 0x%x while the other core runs", offset);
+  }
+  simFlash.program(offset, data, count);
+}
+
+void RP2040::idleOtherCore()
+{
+  otherCoreIdle = true;
+}
+
+void RP2040::resumeOtherCore()
+{
+  otherCoreIdle = false;
+}
+
+void RP2040::reboot()
+{
+  watchdog_reboot(0, 0, 0);
+}
+
+extern "C" {
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+  erase(flash_offs, count, false);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count)
+{
+  program(flash_offs, data, count, false);
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms)
+{
+  (void) pc;
+  (void) sp;
+  (void) delay_ms;
+  simFlash.resets++;
+  otherCoreIdle = false;
+  xipActive = true;
+  throw SimReset();
+}
+
+void simFlashEnableXip(void)
+{
+  xipActive = true;
+}
+
+static void romConnectInternalFlash(void)
+{
+}
+
+static void romFlashExitXip(void)
+{
+  xipActive = false;
+}
+
+static void romFlashRangeErase(uint32_t addr, size_t count, uint32_t block_size, uint8_t block_cmd)
+{
+  (void) block_size;
+  (void) block_cmd;
+  erase(addr, count, true);
+}
+
+static void romFlashRangeProgram(uint32_t addr, const uint8_t* data, size_t count)
+{
+  program(addr, data, count, true);
+}
+
+static void romFlashFlushCache(void)
+{
+}
+
+static void romMemcpy(uint8_t* dest, uint8_t* src, uint32_t n)
+{
+  if (!xipActive && src >= (uint8_t*) XIP_BASE && src < (uint8_t*) XIP_BASE + simFlash.size) {
+    simFlash.error("read of 0x%x after the exit of the XIP mode", src - (uint8_t*) XIP_BASE);
+  }
+  memcpy(dest, src, n);
+}
+
+void* rom_func_lookup(uint32_t code)
+{
+  switch (code) {
+    case rom_table_code('I', 'F'):
+      return (void*) romConnectInternalFlash;
+    case rom_table_code('E', 'X'):
+      return (void*) romFlashExitXip;
+    case rom_table_code('R', 'E'):
+      return (void*) romFlashRangeErase;
+    case rom_table_code('R', 'P'):
+      return (void*) romFlashRangeProgram;
+    case rom_table_code('F', 'C'):
+      return (void*) romFlashFlushCache;
+    case rom_table_code('M', 'C'):
+      return (void*) romMemcpy;
+  }
+  return nullptr;
+}
+
+}
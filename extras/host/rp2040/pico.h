@@ -0,0 +1,50 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the part of the Pico SDK used by the library, over the simulated flash
+
+#ifndef _HOST_PICO_H_INCLUDED
+#define _HOST_PICO_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// the simulated flash is mapped at the address of the XIP flash of the MCU
+#define XIP_BASE 0x10000000
+
+#define __compiler_memory_barrier() __asm__ volatile ("" : : : "memory")
+
+// the functions of the RAM copier get the prefix sim_, so the copier's call of the
+// boot2 code copied from the flash, which can't run on the host, is replaced by the simulation
+#define __no_inline_not_in_flash_func(f) sim_ ## f
+#define copy_flash_pages sim_copy_flash_pages
+#define flash_init_boot2_copyout sim_flash_init_boot2_copyout
+#define flash_enable_xip_via_boot2 simFlashEnableXip
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void simFlashEnableXip(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
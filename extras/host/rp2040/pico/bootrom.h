@@ -0,0 +1,37 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_PICO_BOOTROM_H_INCLUDED
+#define _HOST_PICO_BOOTROM_H_INCLUDED
+
+#include <pico.h>
+
+#define rom_table_code(c1, c2) ((uint32_t) (c1) | ((uint32_t) (c2) << 8))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the simulated functions of the boot ROM
+void* rom_func_lookup(uint32_t code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
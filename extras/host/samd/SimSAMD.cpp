@@ -0,0 +1,165 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimFlash.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// the SAMD21G18 of the Arduino Zero and MKR boards has 256 kB flash in pages of 64 bytes,
+// which are erased in rows of 4 pages. Linux doesn't map the first 64 kB of the address
+// space (vm.mmap_min_addr), so the flash is simulated from 0x10000 and the sketch starts
+// there instead of after the 8 kB bootloader
+__asm__(".globl __text_start__\n .set __text_start__, 0x10000\n");
+
+static const uint32_t FLASH_END = 0x40000;
+static const uint32_t PAGE_SIZE = 64;
+static const uint32_t ROW_SIZE = 4 * PAGE_SIZE;
+
+SimFlash simFlash __attribute__((init_priority(101))) (0x10000, FLASH_END - 0x10000, {ROW_SIZE}, PAGE_SIZE, 6000, 2500);
+SimNvmctrl simNvmctrl __attribute__((init_priority(101)));
+uint32_t simNvmFuses = 0xFFFFFFFF;
+
+// the functions of the library, which run from RAM on the MCU, are in the .data section.
+// the data of the host get executable for them. the stores of the code into the flash
+// go to the NVM controller
+__attribute__((constructor(102)))
+static void initMcu()
+{
+  extern char __data_start[];
+  extern char _edata[];
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t) __data_start & ~(page - 1);
+  mprotect((void*) start, (uintptr_t) _edata - start, PROT_READ | PROT_WRITE | PROT_EXEC);
+  simFlash.trapStores();
+}
+
+SimNvmctrl::SimNvmctrl()
+{
+  PARAM.bit.NVMP = FLASH_END / PAGE_SIZE;
+  PARAM.bit.PSZ = 3; // 8 << PSZ bytes
+  reset();
+}
+
+void SimNvmctrl::reset()
+{
+  CTRLB.bit.MANW = 1;
+  ADDR.reg = 0;
+  clearBuffer();
+  bufferPage = 0;
+}
+
+bool SimNvmctrl::pending() const
+{
+  for (uint32_t i = 0; i < pageSize(); i++) {
+    if (written[i])
+      return true;
+  }
+  return false;
+}
+
+void SimNvmctrl::clearBuffer()
+{
+  memset(pageBuffer, 0xFF, sizeof(pageBuffer));
+  memset(written, 0, sizeof(written));
+  memset(stale, 0, sizeof(stale));
+}
+
+uint32_t SimNvmctrl::pageSize() const
+{
+  return 8 << PARAM.bit.PSZ;
+}
+
+SimNvmctrl::Command& SimNvmctrl::Command::operator=(uint16_t command)
+{
+  simNvmctrl.command(command);
+  return *this;
+}
+
+SimNvmctrl::Ready::operator bool() const
+{
+  simNvmctrl.takeStores();
+  return true; // the simulated operations end immediately
+}
+
+// the stores of the words go to the page buffer. the data stored before for
+// another page stay in the buffer and are written with the page of the last store
+void SimNvmctrl::takeStores()
+{
+  simFlash.takeStores(4, [this](uint32_t offset, const uint8_t* data) {
+    uint32_t address = simFlash.base + offset;
+    uint32_t page = address & ~(pageSize() - 1);
+    if (page != bufferPage) {
+      memcpy(stale, written, sizeof(stale));
+      bufferPage = page;
+    }
+    uint32_t i = address - page;
+    memcpy(pageBuffer + i, data, 4);
+    memset(written + i, 1, 4);
+    memset(stale + i, 0, 4);
+    if (!CTRLB.bit.MANW && i == pageSize() - 4) {
+      writePage(page);
+    }
+  });
+}
+
+void SimNvmctrl::writePage(uint32_t address)
+{
+  for (uint32_t i = 0; i < pageSize(); i++) {
+    if (stale[i]) {
+      simFlash.error("page write at 0x%x with data stored for another page", address);
+      break;
+    }
+  }
+  simFlash.program(address - simFlash.base, pageBuffer, pageSize());
+  clearBuffer();
+}
+
+void SimNvmctrl::command(uint16_t command)
+{
+  takeStores();
+  uint32_t address = ADDR.reg * 2;
+  if ((command & 0xFF00) != NVMCTRL_CTRLA_CMDEX_KEY) {
+    simFlash.error("command 0x%x without the key", command);
+    return;
+  }
+  if (address < simFlash.base || address >= simFlash.base + simFlash.size) {
+    simFlash.error("command at 0x%x outside of the flash", address);
+    return;
+  }
+  switch (command & 0x7F) {
+    case NVMCTRL_CTRLA_CMD_ER:
+      simFlash.erase(address - simFlash.base, ROW_SIZE);
+      break;
+    case NVMCTRL_CTRLA_CMD_WP:
+      writePage(address & ~(pageSize() - 1));
+      break;
+    case NVMCTRL_CTRLA_CMD_PBC:
+      clearBuffer();
+      break;
+    default:
+      simFlash.error("command 0x%x is not simulated", command);
+  }
+}
+
+void NVIC_SystemReset()
+{
+  simFlash.resets++;
+  simNvmctrl.reset();
+  throw SimReset();
+}
@@ -0,0 +1,99 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_SAM_H_INCLUDED
+#define _HOST_SAM_H_INCLUDED
+
+// the part of the CMSIS headers of the SAMD21 used by the library. the NVM controller
+// is a model over the simulated flash
+
+#include <stdint.h>
+
+#define NVMCTRL_CTRLA_CMDEX_KEY (0xA5u << 8)
+#define NVMCTRL_CTRLA_CMD_ER 0x02u // erase row
+#define NVMCTRL_CTRLA_CMD_WP 0x04u // write page
+#define NVMCTRL_CTRLA_CMD_PBC 0x44u // page buffer clear
+
+#define NVMCTRL_FUSES_EEPROM_SIZE_Pos 4
+#define NVMCTRL_FUSES_EEPROM_SIZE_Msk (0x7u << NVMCTRL_FUSES_EEPROM_SIZE_Pos)
+#define NVMCTRL_FUSES_EEPROM_SIZE_ADDR (&simNvmFuses)
+
+// the user row with the fuses. no EEPROM emulation is reserved
+extern uint32_t simNvmFuses;
+
+// the registers of the NVM controller. a write of CTRLA executes the command and a read
+// of INTFLAG.READY takes the stores of the code into the flash to the page buffer. with
+// MANW cleared, the store of the last word of a page writes the page buffer to the page.
+// the operations end immediately
+class SimNvmctrl {
+public:
+  struct Command {
+    Command& operator=(uint16_t command);
+  };
+  struct Ready {
+    operator bool() const;
+  };
+
+  struct {
+    Command reg;
+  } CTRLA;
+  struct {
+    struct {
+      uint8_t MANW;
+    } bit;
+  } CTRLB;
+  struct {
+    uint32_t reg; // the address in half-words
+  } ADDR;
+  struct {
+    struct {
+      Ready READY;
+    } bit;
+  } INTFLAG;
+  struct {
+    struct {
+      uint16_t NVMP;
+      uint8_t PSZ;
+    } bit;
+  } PARAM;
+
+  SimNvmctrl();
+  // the state after a reset of the MCU
+  void reset();
+  // the page buffer has stored data, which are not written to the flash
+  bool pending() const;
+
+  void command(uint16_t command);
+  void takeStores();
+
+private:
+  uint32_t pageSize() const;
+  void clearBuffer();
+  void writePage(uint32_t address);
+
+  uint8_t pageBuffer[1024];
+  bool written[1024]; // the bytes of the page buffer with stored data
+  bool stale[1024]; // the bytes stored for another page
+  uint32_t bufferPage; // the address of the page of the last store
+};
+
+extern SimNvmctrl simNvmctrl;
+
+#define NVMCTRL (&simNvmctrl)
+
+#endif
@@ -0,0 +1,152 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "SimFlash.h"
+
+#include <stm32yyxx_ll_utils.h>
+
+// the STM32F401RE of the Nucleo-F401RE has 512 kB flash in sectors of 16, 16, 16, 16,
+// 64, 128, 128 and 128 kB. a 128 kB sector is erased in a second. the program unit is
+// a half-word of the x16 parallelism, programs of bytes are not simulated. the sketch
+// starts at the start of the flash
+__asm__(".globl g_pfnVectors\n .set g_pfnVectors, 0x08000000\n");
+
+SimFlash simFlash __attribute__((init_priority(101))) (FLASH_BASE, 512 * 1024,
+    {0x4000, 0x4000, 0x4000, 0x4000, 0x10000, 0x20000}, 2, 1000000, 8);
+SimFlashInterface simFlashInterface;
+
+__attribute__((constructor(102)))
+static void initMcu()
+{
+  simFlashInterface.reset();
+  simFlash.trapStores();
+}
+
+uint32_t LL_GetFlashSize(void)
+{
+  return simFlash.size / 1024;
+}
+
+void SimFlashInterface::reset()
+{
+  CR.value = FLASH_CR_LOCK;
+}
+
+static uint32_t parallelism()
+{
+  return 1 << ((simFlashInterface.CR.value & FLASH_CR_PSIZE) >> FLASH_CR_PSIZE_Pos);
+}
+
+// the stores program the flash while PG is set
+void SimFlashInterface::takeStores()
+{
+  simFlash.takeStores(parallelism(), [this](uint32_t offset, const uint8_t* data) {
+    if (!(CR.value & FLASH_CR_PG)) {
+      simFlash.error("store to 0x%x without FLASH_CR_PG", simFlash.base + offset);
+      return;
+    }
+    simFlash.program(offset, data, parallelism());
+  });
+}
+
+SimFlashInterface::Status::operator uint32_t() const
+{
+  simFlashInterface.takeStores();
+  return 0; // never busy
+}
+
+SimFlashInterface::Control& SimFlashInterface::Control::operator=(uint32_t v)
+{
+  simFlashInterface.takeStores(); // with the previous PG and PSIZE
+  if (value & FLASH_CR_LOCK) {
+    simFlash.error("write of FLASH->CR 0x%x while it is locked", v);
+    return *this;
+  }
+  value = v & ~FLASH_CR_STRT;
+  if (!(v & FLASH_CR_STRT))
+    return *this;
+  if (v & FLASH_CR_MER) {
+    simFlash.erase(0, simFlash.size);
+  } else if (v & FLASH_CR_SER) {
+    uint32_t sector = (v & FLASH_CR_SNB) >> FLASH_CR_SNB_Pos;
+    if (sector >= simFlash.units()) {
+      simFlash.error("erase of sector %u, which doesn't exist", sector);
+    } else {
+      simFlash.erase(simFlash.unitStart(sector), simFlash.unitSize(sector));
+    }
+  }
+  return *this;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  simFlashInterface.CR.value &= ~FLASH_CR_LOCK; // the keys written to KEYR
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  simFlashInterface.takeStores();
+  simFlashInterface.CR.value |= FLASH_CR_LOCK;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* SectorError)
+{
+  simFlashInterface.takeStores();
+  *SectorError = 0xFFFFFFFFU;
+  if (simFlashInterface.CR.value & FLASH_CR_LOCK) {
+    simFlash.error("erase of sector %u while the flash is locked", pEraseInit->Sector);
+    return HAL_ERROR;
+  }
+  if (pEraseInit->TypeErase == FLASH_TYPEERASE_MASSERASE)
+    return simFlash.erase(0, simFlash.size) ? HAL_OK : HAL_ERROR;
+  for (uint32_t sector = pEraseInit->Sector; sector < pEraseInit->Sector + pEraseInit->NbSectors; sector++) {
+    if (sector >= simFlash.units()) {
+      simFlash.error("erase of sector %u, which doesn't exist", sector);
+      *SectorError = sector;
+      return HAL_ERROR;
+    }
+    simFlash.erase(simFlash.unitStart(sector), simFlash.unitSize(sector));
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  simFlashInterface.takeStores();
+  if (simFlashInterface.CR.value & FLASH_CR_LOCK) {
+    simFlash.error("program at 0x%x while the flash is locked", Address);
+    return HAL_ERROR;
+  }
+  uint32_t size = 1 << TypeProgram;
+  if (Address % size || Address < simFlash.base || Address - simFlash.base + size > simFlash.size) {
+    simFlash.error("program at 0x%x not aligned or outside of the flash", Address);
+    return HAL_ERROR;
+  }
+  uint8_t data[8];
+  memcpy(data, &Data, size); // little endian
+  return simFlash.program(Address - simFlash.base, data, size) ? HAL_OK : HAL_ERROR;
+}
+
+void NVIC_SystemReset()
+{
+  simFlash.resets++;
+  simFlashInterface.reset();
+  throw SimReset();
+}
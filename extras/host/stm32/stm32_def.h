@@ -0,0 +1,116 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HOST_STM32_DEF_H_INCLUDED
+#define _HOST_STM32_DEF_H_INCLUDED
+
+// the part of the STM32F4 HAL and CMSIS headers used by the library. the flash
+// interface and the HAL flash functions are a model over the simulated flash.
+// the library's C sources which use the registers are compiled as C++
+
+#include <stdint.h>
+
+#ifndef STM32F4xx
+#define STM32F4xx
+#endif
+
+#define FLASH_BASE 0x08000000UL
+
+typedef enum {
+  HAL_OK,
+  HAL_ERROR,
+  HAL_BUSY,
+  HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_SECTORS 0x00U
+#define FLASH_TYPEERASE_MASSERASE 0x01U
+#define FLASH_VOLTAGE_RANGE_3 0x02U // x32 parallelism
+#define FLASH_BANK_1 1U
+
+#define FLASH_TYPEPROGRAM_BYTE 0x00U
+#define FLASH_TYPEPROGRAM_HALFWORD 0x01U
+#define FLASH_TYPEPROGRAM_WORD 0x02U
+#define FLASH_TYPEPROGRAM_DOUBLEWORD 0x03U
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* SectorError);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+
+#define FLASH_SR_BSY (1U << 16)
+#define FLASH_CR_PG (1U << 0)
+#define FLASH_CR_SER (1U << 1)
+#define FLASH_CR_MER (1U << 2)
+#define FLASH_CR_SNB_Pos 3U
+#define FLASH_CR_SNB (0xFU << FLASH_CR_SNB_Pos)
+#define FLASH_CR_PSIZE_Pos 8U
+#define FLASH_CR_PSIZE (0x3U << FLASH_CR_PSIZE_Pos)
+#define FLASH_CR_STRT (1U << 16)
+#define FLASH_CR_LOCK (1U << 31)
+
+#define SET_BIT(REG, BIT) ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+#define WRITE_REG(REG, VAL) ((REG) = (VAL))
+
+// the registers of the flash interface. a write of CR executes the erase started with
+// STRT and a read of SR takes the stores of the code into the flash, which program it
+// with the parallelism of PSIZE while PG is set. the operations end immediately
+class SimFlashInterface {
+public:
+  struct Control {
+    uint32_t value;
+    Control& operator=(uint32_t v);
+    Control& operator|=(uint32_t v) {
+      return *this = value | v;
+    }
+    Control& operator&=(uint32_t v) {
+      return *this = value & v;
+    }
+    operator uint32_t() const {
+      return value;
+    }
+  };
+  struct Status {
+    operator uint32_t() const;
+  };
+
+  Status SR;
+  Control CR;
+
+  // the state after a reset of the MCU
+  void reset();
+  void takeStores();
+};
+
+extern SimFlashInterface simFlashInterface;
+
+#define FLASH (&simFlashInterface)
+
+// the CMSIS reset. the model resets the flash interface and throws SimReset
+void NVIC_SystemReset();
+
+#endif
@@ -0,0 +1,51 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _CHECK_H_INCLUDED
+#define _CHECK_H_INCLUDED
+
+#include <stdio.h>
+
+// counts and prints the failed checks. a test returns checkResult() from main()
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+inline int& checkFailures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+inline bool check(bool ok, const char* condition, const char* file, int line)
+{
+  if (!ok) {
+    printf("%s:%d: check failed: %s\n", file, line, condition);
+    checkFailures()++;
+  }
+  return ok;
+}
+
+inline int checkResult()
+{
+  if (checkFailures()) {
+    printf("%d checks failed\n", checkFailures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// write, close and apply of the RP2040 InternalStorage in the simulated flash.
+// with arguments it prints the erases, programs, times and wear of the update
+// of a running sketch binary with a new sketch binary:
+//
+//   test-flash sketch.bin [running.bin]
+
+#include "session.h"
+#include "check.h"
+
+#include <hardware/flash.h>
+
+struct FlashCounts {
+  unsigned long erases;
+  unsigned long programs;
+  unsigned long ms;
+};
+
+static FlashCounts counts(const FlashCounts& start)
+{
+  return {simFlash.erases - start.erases, simFlash.programs - start.programs, millis() - start.ms};
+}
+
+static FlashCounts now()
+{
+  return {simFlash.erases, simFlash.programs, millis()};
+}
+
+// writes the binary in parts as the upload server does and applies it
+static bool update(const std::vector<uint8_t>& running, const std::vector<uint8_t>& image, FlashCounts& write, FlashCounts& apply)
+{
+  simFlash.reset();
+  simFlash.load(0, running.data(), running.size());
+
+  FlashCounts start = now();
+  if (!InternalStorage.open(image.size()))
+    return false;
+  for (size_t i = 0; i < image.size(); i += 64) {
+    InternalStorage.write(image.data() + i, min((size_t) 64, image.size() - i));
+  }
+  InternalStorage.close();
+  write = counts(start);
+
+  start = now();
+  try {
+    InternalStorage.apply();
+  } catch (SimReset&) {
+  }
+  apply = counts(start);
+  return simFlash.resets == 1;
+}
+
+static void print(const char* phase, const FlashCounts& c)
+{
+  printf("%s: %lu erases, %lu programs, %lu ms\n", phase, c.erases, c.programs, c.ms);
+}
+
+static void testUpdate()
+{
+  std::vector<uint8_t> running = makeImage(100000, 1);
+  std::vector<uint8_t> image = running;
+  // a change in sector 2, a longer sector 5 and 6 and a blank page in sector 7
+  image[2 * FLASH_SECTOR_SIZE + 100] ^= 1;
+  image.insert(image.begin() + 5 * FLASH_SECTOR_SIZE + 10, 20, 0x55);
+  memset(image.data() + 7 * FLASH_SECTOR_SIZE, 0xFF, FLASH_PAGE_SIZE);
+
+  FlashCounts write, apply;
+  CHECK(update(running, image, write, apply));
+  size_t sectors = (image.size() + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+  size_t pages = (image.size() + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+  CHECK(write.erases == sectors); // only the sectors of the binary
+  CHECK(write.programs == pages);
+  CHECK(write.ms == sectors * 45 + pages * 800 / 1000);
+
+  // the sectors from the inserted bytes to the end of the binary differ
+  size_t changed = 1 + sectors - 5;
+  CHECK(apply.erases == changed);
+  CHECK(apply.programs == changed * FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE - 1 - (sectors * FLASH_SECTOR_SIZE - image.size()) / FLASH_PAGE_SIZE);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.maxWear() == 1);
+  CHECK(simFlash.errors == 0);
+}
+
+static void testSameSketch()
+{
+  std::vector<uint8_t> image = makeImage(50000, 2);
+  FlashCounts write, apply;
+  CHECK(update(image, image, write, apply));
+  CHECK(apply.erases == 0);
+  CHECK(apply.programs == 0);
+  CHECK(simFlash.errors == 0);
+}
+
+static void testMaxSize()
+{
+  CHECK(InternalStorage.maxSize() % FLASH_SECTOR_SIZE == 0); // the storage starts at a sector
+  CHECK(InternalStorage.maxSize() == (simFlash.size - FLASH_SECTOR_SIZE) / 2 / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE);
+
+  std::vector<uint8_t> image = makeImage(InternalStorage.maxSize(), 3);
+  FlashCounts write, apply;
+  CHECK(update(makeImage(1000, 4), image, write, apply));
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.errors == 0);
+  CHECK(!InternalStorage.open(InternalStorage.maxSize() + 1));
+}
+
+static std::vector<uint8_t> readFile(const char* name)
+{
+  std::vector<uint8_t> data;
+  FILE* f = fopen(name, "rb");
+  if (!f)
+    return data;
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    data.push_back(c);
+  }
+  fclose(f);
+  return data;
+}
+
+static int simulate(const char* sketch, const char* running)
+{
+  std::vector<uint8_t> image = readFile(sketch);
+  if (image.empty()) {
+    printf("can't read %s\n", sketch);
+    return 1;
+  }
+  FlashCounts write, apply;
+  if (!update(running ? readFile(running) : std::vector<uint8_t>(), image, write, apply)) {
+    printf("the binary is larger than the storage (%ld bytes)\n", InternalStorage.maxSize());
+    return 1;
+  }
+  print("upload write", write);
+  print("apply", apply);
+  unsigned long sectors = 0;
+  for (uint16_t w : simFlash.wear) {
+    sectors += (w > 0);
+  }
+  printf("wear: %lu sectors erased, at most %u times\n", sectors, simFlash.maxWear());
+  if (memcmp(simFlash.memory(), image.data(), image.size())) {
+    printf("error: the applied sketch differs from the binary\n");
+    return 1;
+  }
+  return simFlash.errors ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1)
+    return simulate(argv[1], (argc > 2) ? argv[2] : nullptr);
+
+  testUpdate();
+  testSameSketch();
+  testMaxSize();
+  return checkResult();
+}
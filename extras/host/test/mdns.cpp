@@ -0,0 +1,240 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the TXT record of the mDNS service announced after begin() and
+// the responses to the queries parsed from the UDP socket
+
+#include "session.h"
+#include "check.h"
+
+// a storage without support of resumed uploads
+class TestStorage : public OTAStorage {
+public:
+  virtual int open(int) {return 1;}
+  virtual size_t write(uint8_t) {return 1;}
+  virtual void close() {}
+  virtual void clear() {}
+  virtual void apply() {}
+};
+
+// returns the ota_features value of the first announcement
+static std::string announcedFeatures(OTAStorage& storage)
+{
+  SimArduinoOTA ota;
+  simNetwork.sent.clear();
+  ota.begin(IPAddress(192, 168, 1, 10), "host", "password", storage);
+  for (int i = 0; i < 100 && simNetwork.sent.empty(); i++) {
+    ota.poll();
+    delay(10);
+  }
+  ota.end();
+  if (simNetwork.sent.empty())
+    return "";
+  const std::string& packet = simNetwork.sent.front().data;
+  size_t i = packet.find("ota_features=");
+  if (i == std::string::npos)
+    return "";
+  i += 13;
+  size_t length = (uint8_t) packet[i - 14] - 13; // the TXT string is prefixed by its length
+  return packet.substr(i, length);
+}
+
+static void testFeatures()
+{
+  std::string features = announcedFeatures(InternalStorage);
+  CHECK(features == "heatshrink,resume,crc32,sha256,delta,pages");
+
+  TestStorage storage;
+  features = announcedFeatures(storage);
+  CHECK(features == "heatshrink,crc32,sha256,delta,pages");
+}
+
+static const IPAddress QUERIER(192, 168, 1, 20);
+
+// a packet of a query built of the header, the names and the records
+class Query {
+public:
+  Query(uint16_t questions, uint16_t answers = 0, uint16_t id = 0) {
+    add16(id);
+    add16(0); // flags of a query
+    add16(questions);
+    add16(answers);
+    add16(0);
+    add16(0);
+  }
+
+  // the offset of the name for a compressed name. the name ends with a pointer if `pointer` isn't 0
+  size_t name(std::initializer_list<const char*> labels, uint16_t pointer = 0) {
+    size_t offset = data.size();
+    for (const char* label : labels) {
+      data += (char) strlen(label);
+      data += label;
+    }
+    if (pointer) {
+      add16(0xC000 | pointer);
+    } else {
+      data += '\0';
+    }
+    return offset;
+  }
+
+  void add16(uint16_t value) {
+    data += (char) (value >> 8);
+    data += (char) value;
+  }
+
+  std::string data;
+};
+
+#define QU 0x8000
+#define IN 1
+
+static SimArduinoOTA ota;
+
+// sends the query to the board and returns the packets it sent in 1.5 seconds,
+// which is more than the delay of a multicast response and its rate limit
+static std::vector<SimPacket> ask(const Query& query, uint16_t port = 5353)
+{
+  simNetwork.sent.clear();
+  simNetwork.received.push_back({QUERIER, port, query.data});
+  for (int i = 0; i < 1500; i++) {
+    ota.poll();
+    delay(1);
+  }
+  return simNetwork.sent;
+}
+
+static bool multicast(const std::vector<SimPacket>& sent)
+{
+  return sent.size() == 1 && sent[0].ip == IPAddress(224, 0, 0, 251) && sent[0].port == 5353;
+}
+
+static bool unicast(const std::vector<SimPacket>& sent, uint16_t port = 5353)
+{
+  return sent.size() == 1 && sent[0].ip == QUERIER && sent[0].port == port;
+}
+
+static void testQueries()
+{
+  ota.begin(IPAddress(192, 168, 1, 10), "host", "password", InternalStorage);
+  for (int i = 0; i < 4000; i++) { // the announcements
+    ota.poll();
+    delay(1);
+  }
+
+  Query q(1);
+  q.name({"_arduino", "_tcp", "local"});
+  q.add16(12); // PTR
+  q.add16(IN);
+  CHECK(multicast(ask(q)));
+
+  // the service in the second question is compressed to the end of the host name
+  q = Query(2);
+  size_t local = q.name({"HOST", "local"}) + 5;
+  q.add16(1); // A
+  q.add16(IN | QU);
+  q.name({"_arduino", "_tcp"}, local);
+  q.add16(12);
+  q.add16(IN | QU);
+  CHECK(unicast(ask(q)));
+
+  // the first question asks for a multicast response
+  q = Query(2);
+  local = q.name({"host", "local"}) + 5;
+  q.add16(1);
+  q.add16(IN);
+  q.name({"_arduino", "_tcp"}, local);
+  q.add16(12);
+  q.add16(IN | QU);
+  CHECK(multicast(ask(q)));
+
+  // other names don't match, also as compressed names
+  q = Query(2);
+  size_t tcp = q.name({"_other", "_tcp", "local"}) + 7;
+  q.add16(12);
+  q.add16(IN);
+  q.name({"host", "_other"}, tcp);
+  q.add16(33); // SRV
+  q.add16(IN);
+  CHECK(ask(q).empty());
+
+  // our PTR record in the known answers, with the instance name compressed to the question
+  q = Query(1, 1);
+  size_t service = q.name({"_arduino", "_tcp", "local"});
+  q.add16(12);
+  q.add16(IN);
+  q.add16(0xC000 | service);
+  q.add16(12);
+  q.add16(IN);
+  q.add16(0);
+  q.add16(4500); // TTL
+  q.add16(7); // length of the data
+  q.name({"host"}, service);
+  CHECK(ask(q).empty());
+
+  // with a known answer of another instance first. a longer query than a buffer for the packet would be
+  q = Query(1, 4);
+  service = q.name({"_arduino", "_tcp", "local"});
+  q.add16(12);
+  q.add16(IN);
+  for (const char* instance : {"board-with-a-long-name-for-a-long-query-1", "board-with-a-long-name-for-a-long-query-2"}) {
+    q.add16(0xC000 | service);
+    q.add16(12);
+    q.add16(IN);
+    q.add16(0);
+    q.add16(4500);
+    q.add16(strlen(instance) + 3);
+    q.name({instance}, service);
+    std::string txt(300, 'x');
+    q.add16(0xC000 | service);
+    q.add16(16); // TXT
+    q.add16(IN);
+    q.add16(0);
+    q.add16(4500);
+    q.add16(txt.size());
+    q.data += txt;
+  }
+  CHECK(q.data.size() > 512);
+  CHECK(multicast(ask(q)));
+  q.data[7] = 5; // with our PTR record at the end
+  q.add16(0xC000 | service);
+  q.add16(12);
+  q.add16(IN);
+  q.add16(0);
+  q.add16(4500);
+  q.add16(7);
+  q.name({"host"}, service);
+  CHECK(ask(q).empty());
+
+  // a legacy resolver gets the response with the id of the query
+  q = Query(1, 0, 0x1234);
+  q.name({"host", "local"});
+  q.add16(1);
+  q.add16(IN);
+  std::vector<SimPacket> sent = ask(q, 40000);
+  CHECK(unicast(sent, 40000) && sent[0].data.compare(0, 2, "\x12\x34") == 0);
+
+  ota.end();
+}
+
+int main()
+{
+  testFeatures();
+  testQueries();
+  return checkResult();
+}
@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// uploads over a simulated network with small segments, a slow link, stalls and
+// a premature close. prints the throughput, the reads and the spins of the server.
+// test-network-single-read runs the same uploads with the server built with
+// OTA_RECEIVE_READS=1, the read loop before the receive buffer was filled from more reads
+
+#include "session.h"
+#include "check.h"
+
+struct Scenario {
+  const char* name;
+  std::vector<size_t> segments;
+  unsigned long bytesPerSecond;
+  std::vector<SimStall> stalls; // offsets in the body
+  size_t closeAt; // offset in the body
+  bool nonBlocking;
+  int code; // of the response
+};
+
+static const size_t IMAGE_SIZE = 65536;
+static const size_t NO_CLOSE = std::string::npos;
+
+// a sketch showing the progress on a display
+static const unsigned long PROGRESS_MICROS = 100;
+
+static SimArduinoOTA ota;
+static unsigned long passes;
+static unsigned long bodyMicros;
+
+static void progress(unsigned long, unsigned long)
+{
+  passes++;
+  advanceMicros(PROGRESS_MICROS);
+}
+
+static void sessionEnd(int, const OTASessionTimes& times)
+{
+  bodyMicros = times.body;
+}
+
+static void run(const Scenario& s, unsigned long seed)
+{
+  std::vector<uint8_t> image = makeImage(IMAGE_SIZE, seed);
+  std::string r = request("POST", "/sketch", toString(image));
+  size_t headers = r.size() - image.size();
+
+  std::shared_ptr<SimConnection> c = simNetwork.connect(r);
+  c->segments = s.segments;
+  c->bytesPerSecond = s.bytesPerSecond;
+  for (const SimStall& stall : s.stalls) {
+    c->stalls.push_back({headers + stall.offset, stall.ms});
+  }
+  if (s.closeAt != NO_CLOSE) {
+    c->closeAt = headers + s.closeAt;
+  }
+  passes = 0;
+  bodyMicros = 0;
+  ota.setNonBlocking(s.nonBlocking);
+  bool reset = runSession(ota, c);
+  ota.setNonBlocking(false);
+
+  unsigned long reads = c->reads - headers; // the headers are read by bytes
+  size_t received = c->readIndex - headers;
+  unsigned long kBps = bodyMicros ? received * 1000 / bodyMicros : 0;
+  printf("%-28s %4d %8lu %6lu %7lu %7lu %9lu\n", s.name, c->responseCode(),
+      bodyMicros / 1000, kBps, reads, passes, c->spins);
+
+  CHECK(c->responseCode() == s.code);
+  CHECK(reset == (s.code == 200));
+  if (s.code == 200) {
+    CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  }
+#if OTA_RECEIVE_READS == 1
+  CHECK(passes == reads);
+#else
+  CHECK(passes <= reads);
+  if (s.nonBlocking) { // a poll() does only a few reads
+    CHECK(reads <= passes * OTA_RECEIVE_READS_NON_BLOCKING);
+  } else if (!s.bytesPerSecond && s.stalls.empty() && s.code == 200) { // the buffer is always filled
+    CHECK(passes == (IMAGE_SIZE + 63) / 64);
+  }
+#endif
+  CHECK(simFlash.errors == 0);
+}
+
+int main()
+{
+  const Scenario scenarios[] = {
+    {"full segments", {}, 0, {}, NO_CLOSE, false, 200},
+    {"byte segments", {1, 2, 1, 3}, 0, {}, NO_CLOSE, false, 200},
+    {"byte segments non-blocking", {1, 2, 1, 3}, 0, {}, NO_CLOSE, true, 200},
+    {"slow link", {536}, 50000, {}, NO_CLOSE, false, 200},
+    {"stalls", {536}, 50000, {{16384, 2000}, {32768, 5000}, {49152, 8000}}, NO_CLOSE, false, 200},
+    {"stalls non-blocking", {536}, 50000, {{16384, 2000}, {32768, 5000}, {49152, 8000}}, NO_CLOSE, true, 200},
+    {"stall over the idle timeout", {536}, 50000, {{32768, 45000}}, NO_CLOSE, false, 408},
+    {"premature close", {1460}, 0, {}, 40000, false, 414},
+  };
+
+  ota.begin(IPAddress(192, 168, 1, 10), "host", "password", InternalStorage);
+  ota.onProgress(progress);
+  ota.onSessionEnd(sessionEnd);
+
+  printf("OTA_RECEIVE_READS %d, OTA_RECEIVE_READS_NON_BLOCKING %d, the progress callback takes %lu us\n",
+      OTA_RECEIVE_READS, OTA_RECEIVE_READS_NON_BLOCKING, PROGRESS_MICROS);
+  printf("%-28s %4s %8s %6s %7s %7s %9s\n", "scenario", "code", "body ms", "kB/s", "reads", "passes", "spins");
+  unsigned long seed = 1;
+  for (const Scenario& s : scenarios) {
+    run(s, seed++);
+  }
+  return checkResult();
+}
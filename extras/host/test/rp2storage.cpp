@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// open, write, close, suspend and resume of the RP2040 InternalStorage in the simulated flash
+
+#include "session.h"
+#include "check.h"
+
+#include <hardware/flash.h>
+
+static const uint8_t* storage()
+{
+  return simFlash.memory() + InternalStorage.maxSize();
+}
+
+// the storage area with a previous upload, so only erased and programmed bytes are as expected
+static void prepare()
+{
+  simFlash.reset();
+  std::vector<uint8_t> junk(8 * FLASH_SECTOR_SIZE, 0xA5);
+  simFlash.load(InternalStorage.maxSize(), junk.data(), junk.size());
+}
+
+static void write(const std::vector<uint8_t>& image, size_t from, size_t to, size_t part)
+{
+  for (size_t i = from; i < to; i += part) {
+    InternalStorage.write(image.data() + i, min(part, to - i));
+  }
+}
+
+static bool erased(const uint8_t* p, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    if (p[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+static bool apply(const std::vector<uint8_t>& image)
+{
+  try {
+    InternalStorage.apply();
+  } catch (SimReset&) {
+  }
+  return simFlash.resets == 1 && !memcmp(simFlash.memory(), image.data(), image.size());
+}
+
+static void testUnalignedLength()
+{
+  std::vector<uint8_t> image = makeImage(3 * FLASH_SECTOR_SIZE + 1037, 1);
+  prepare();
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, image.size(), 333);
+  InternalStorage.close();
+
+  size_t pages = (image.size() + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+  CHECK(simFlash.erases == 4);
+  CHECK(simFlash.programs == pages);
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  // the last page is padded and the rest of the last sector is erased
+  CHECK(erased(storage() + image.size(), 4 * FLASH_SECTOR_SIZE - image.size()));
+  CHECK(storage()[4 * FLASH_SECTOR_SIZE] == 0xA5); // not erased after the binary
+
+  CHECK(apply(image));
+  CHECK(simFlash.errors == 0);
+}
+
+static void testSuspendResume()
+{
+  std::vector<uint8_t> image = makeImage(20000, 2);
+  prepare();
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, 10000, 100);
+  // only the programmed sectors are kept. the buffered data are sent again
+  long offset = InternalStorage.suspend();
+  CHECK(offset == 2 * FLASH_SECTOR_SIZE);
+  CHECK(!memcmp(storage(), image.data(), offset));
+
+  CHECK(InternalStorage.resume(image.size(), offset));
+  write(image, offset, image.size(), 100);
+  InternalStorage.close();
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(erased(storage() + image.size(), 5 * FLASH_SECTOR_SIZE - image.size()));
+  CHECK(simFlash.maxWear() == 1); // no sector was erased twice
+
+  CHECK(apply(image));
+  CHECK(simFlash.errors == 0);
+}
+
+static void testUnalignedResume()
+{
+  std::vector<uint8_t> image = makeImage(30000, 3);
+  prepare();
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, 3 * FLASH_SECTOR_SIZE + 500, 64);
+  CHECK(InternalStorage.suspend() == 3 * FLASH_SECTOR_SIZE);
+
+  // the part of the sector before the offset is read from the flash and programmed again
+  CHECK(InternalStorage.resume(image.size(), 10000));
+  write(image, 10000, image.size(), 64);
+  InternalStorage.close();
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(erased(storage() + image.size(), 8 * FLASH_SECTOR_SIZE - image.size()));
+  CHECK(simFlash.errors == 0);
+
+  CHECK(!InternalStorage.resume(image.size(), image.size() + 1));
+  CHECK(!InternalStorage.resume(InternalStorage.maxSize() + 1, 0));
+}
+
+int main()
+{
+  testUnalignedLength();
+  testSuspendResume();
+  testUnalignedResume();
+  return checkResult();
+}
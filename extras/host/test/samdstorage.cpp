@@ -0,0 +1,180 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// write, suspend, resume, close and apply of the SAMD InternalStorage over the model
+// of the NVM controller of the SAMD21, with pages of 64 bytes erased in rows of 4 pages
+
+#include "session.h"
+#include "check.h"
+
+static const uint32_t PAGE = 64;
+static const uint32_t ROW = 4 * PAGE;
+
+// the storage is the upper half of the sketch area
+static const uint8_t* storage()
+{
+  return simFlash.memory() + simFlash.size - InternalStorage.maxSize();
+}
+
+// the storage area with a previous upload, so only erased and programmed bytes are as expected
+static void prepare()
+{
+  simFlash.reset();
+  std::vector<uint8_t> junk(8 * ROW, 0xA5);
+  simFlash.load(simFlash.size - InternalStorage.maxSize(), junk.data(), junk.size());
+}
+
+static void write(const std::vector<uint8_t>& image, size_t from, size_t to, size_t part)
+{
+  for (size_t i = from; i < to; i += part) {
+    InternalStorage.write(image.data() + i, min(part, to - i));
+  }
+}
+
+static bool erased(const uint8_t* p, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    if (p[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+static void testGeometry()
+{
+  CHECK(simFlash.base == 0x10000); // the sketch start
+  CHECK(InternalStorage.maxSize() == 0x18000);
+  CHECK(simFlash.unitSize(0) == ROW);
+}
+
+// the rows are erased when the write enters them and the last page is completed
+static void testWrite()
+{
+  prepare();
+  std::vector<uint8_t> image = makeImage(3 * ROW + 37, 1);
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, image.size(), 61);
+  InternalStorage.close();
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(simFlash.erases == 4);
+  CHECK(simFlash.programs == (image.size() + PAGE - 1) / PAGE);
+  CHECK(erased(storage() + image.size(), 4 * ROW - image.size()));
+  CHECK(storage()[4 * ROW] == 0xA5); // not erased after the binary
+  CHECK(!simNvmctrl.pending());
+  CHECK(simFlash.errors == 0);
+}
+
+// the resume starts at the row with the data left in the page buffer
+static void testResume()
+{
+  prepare();
+  std::vector<uint8_t> image = makeImage(5 * ROW + 100, 2);
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, 2 * ROW + 100, 64);
+  long offset = InternalStorage.suspend();
+  CHECK(offset == 2 * ROW);
+  CHECK(simNvmctrl.pending()); // 36 bytes of the second page of the row
+  CHECK(InternalStorage.resume(image.size(), offset));
+  write(image, offset, image.size(), 61);
+  InternalStorage.close();
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(simFlash.maxWear() == 2); // the row of the suspend
+  CHECK(simFlash.errors == 0);
+}
+
+// the copy skips the unchanged rows and the blank pages
+static void testApply()
+{
+  simFlash.reset();
+  std::vector<uint8_t> running = makeImage(40 * ROW, 3);
+  simFlash.load(0, running.data(), running.size());
+  std::vector<uint8_t> image = running;
+  image[5 * ROW + 10] ^= 1;
+  image[10 * ROW] ^= 1;
+  memset(image.data() + 10 * ROW + 2 * PAGE, 0xFF, PAGE);
+  image.resize(40 * ROW + 100, 0x33);
+
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, image.size(), 512);
+  InternalStorage.close();
+  unsigned long erases = simFlash.erases;
+  unsigned long programs = simFlash.programs;
+  try {
+    InternalStorage.apply();
+  } catch (SimReset&) {
+  }
+  CHECK(simFlash.resets == 1);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.erases - erases == 3);
+  CHECK(simFlash.programs - programs == 4 + 3 + 2);
+  CHECK(simFlash.wear[5] == 1 && simFlash.wear[6] == 0);
+  CHECK(simFlash.errors == 0);
+}
+
+static void erase(uint32_t address)
+{
+  NVMCTRL->ADDR.reg = address / 2;
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+  while (!NVMCTRL->INTFLAG.bit.READY);
+}
+
+static void store(uint32_t address, uint32_t words)
+{
+  for (uint32_t i = 0; i < words; i++) {
+    *(volatile uint32_t*) (address + 4 * i) = 0x12345678;
+    while (!NVMCTRL->INTFLAG.bit.READY);
+  }
+}
+
+// the model reports the misuse of the NVM controller
+static void testModel()
+{
+  simFlash.reset();
+  simNvmctrl.reset();
+  NVMCTRL->CTRLB.bit.MANW = 0;
+  uint32_t row = simFlash.base + 8 * ROW;
+
+  std::vector<uint8_t> junk(PAGE, 0xA5);
+  simFlash.load(8 * ROW, junk.data(), junk.size());
+  store(row, PAGE / 4); // not erased
+  CHECK(simFlash.errors == 1);
+
+  erase(row);
+  store(row + 4, 1); // left in the page buffer
+  store(row + PAGE, PAGE / 4); // overwrites the same bytes of the page buffer
+  CHECK(simFlash.errors == 1);
+  store(row + 4, 1);
+  store(row + 2 * PAGE + 8, PAGE / 4 - 2);
+  CHECK(simFlash.errors == 2);
+  CHECK(strstr(simFlash.lastError, "another page"));
+
+  erase(row + 2);
+  CHECK(simFlash.errors == 3); // not at the start of a row
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMD_ER;
+  CHECK(simFlash.errors == 4); // without the key
+}
+
+int main()
+{
+  testGeometry();
+  testWrite();
+  testResume();
+  testApply();
+  testModel();
+  return checkResult();
+}
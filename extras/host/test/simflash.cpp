@@ -0,0 +1,110 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the simulated flash with the geometries and the timings of the flash of the MCUs.
+// the flash of the RP2040 is the one of the tests. the other flashes are mapped at
+// free addresses of the host, the tests of their models map them at their addresses
+
+#include "session.h"
+#include "check.h"
+
+#include <hardware/flash.h>
+
+// erases and programs the erase unit and checks the refused misuse
+static void checkUnit(SimFlash& flash, size_t unit, unsigned long eraseMicros)
+{
+  uint32_t start = flash.unitStart(unit);
+  uint32_t size = flash.unitSize(unit);
+  std::vector<uint8_t> data(size, 0x5A);
+  unsigned long t = micros();
+  CHECK(flash.erase(start, size));
+  CHECK(micros() - t == eraseMicros);
+  CHECK(flash.wear[unit] == 1);
+  t = micros();
+  CHECK(flash.program(start, data.data(), size));
+  CHECK(micros() - t == size / flash.programSize * flash.programMicros);
+  CHECK(!memcmp(flash.memory() + start, data.data(), size));
+
+  unsigned long errors = flash.errors;
+  CHECK(!flash.erase(start + size / 2, size)); // not at the start of the unit
+  flash.program(start, data.data(), flash.programSize); // not erased
+  CHECK(flash.errors == errors + 2);
+  if (flash.programSize > 1) {
+    CHECK(!flash.program(start + flash.programSize / 2, data.data(), flash.programSize));
+    CHECK(!flash.program(start, data.data(), flash.programSize / 2));
+  }
+}
+
+// 4 kB sectors of the QSPI flash programmed in pages of 256 bytes
+static void testRP2040()
+{
+  simFlash.reset();
+  CHECK(simFlash.units() == 512);
+  CHECK(simFlash.unitSize(511) == FLASH_SECTOR_SIZE);
+  CHECK(simFlash.programSize == FLASH_PAGE_SIZE);
+  checkUnit(simFlash, 10, 45000);
+}
+
+// rows of 4 pages of 64 bytes
+static void testSAMD21()
+{
+  SimFlash flash(0x20000000, 256 * 1024, {256}, 64, 6000, 2500);
+  CHECK(flash.units() == 1024);
+  checkUnit(flash, 3, 6000);
+  CHECK(!flash.erase(3 * 256, 64)); // a page
+}
+
+// sectors of 16, 64 and 128 kB programmed in half-words
+static void testSTM32F4()
+{
+  SimFlash flash(0x08000000, 512 * 1024, {0x4000, 0x4000, 0x4000, 0x4000, 0x10000, 0x20000}, 2, 1000000, 8);
+  CHECK(flash.units() == 8);
+  CHECK(flash.unitSize(3) == 0x4000 && flash.unitSize(4) == 0x10000 && flash.unitSize(7) == 0x20000);
+  CHECK(flash.unitAt(0x1FFFF) == 4 && flash.unitAt(0x20000) == 5 && flash.unitAt(0x7FFFF) == 7);
+  checkUnit(flash, 1, 125000);
+  checkUnit(flash, 4, 500000);
+  checkUnit(flash, 6, 1000000);
+  CHECK(flash.erase(0x8000, 0x8000)); // sectors 2 and 3
+  CHECK(!flash.erase(0x10000, 0x4000)); // a part of sector 4
+}
+
+// the code flash of the RA4M1 of the UNO R4 in blocks of 2 kB written in units of 8 bytes
+static void testRenesas()
+{
+  SimFlash flash(0x30000000, 256 * 1024, {2048}, 8, 12000, 70);
+  CHECK(flash.units() == 128);
+  checkUnit(flash, 100, 12000);
+}
+
+// the SPM pages of 256 bytes of the ATmega2560, erased and written whole
+static void testAVR()
+{
+  SimFlash flash(0x40000000, 256 * 1024, {256}, 256, 4500, 4500);
+  CHECK(flash.units() == 1024);
+  checkUnit(flash, 512, 4500);
+}
+
+int main()
+{
+  testRP2040();
+  testSAMD21();
+  testSTM32F4();
+  testRenesas();
+  testAVR();
+  return checkResult();
+}
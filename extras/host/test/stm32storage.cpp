@@ -0,0 +1,163 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// write, suspend, resume, close and apply of the STM32 InternalStorage over the model
+// of the flash interface of the STM32F4, with the storage in the 128 kB sector 5 and
+// the sketch in the sectors 0 to 4 of 16 and 64 kB
+
+#include "session.h"
+#include "check.h"
+
+static const uint32_t STORAGE = 0x20000; // sector 5
+
+static const uint8_t* storage()
+{
+  return simFlash.memory() + STORAGE;
+}
+
+// the storage area with a previous upload, so only erased and programmed bytes are as expected
+static void prepare()
+{
+  simFlash.reset();
+  std::vector<uint8_t> junk(0x10000, 0xA5);
+  simFlash.load(STORAGE, junk.data(), junk.size());
+}
+
+static void write(const std::vector<uint8_t>& image, size_t from, size_t to, size_t part)
+{
+  for (size_t i = from; i < to; i += part) {
+    InternalStorage.write(image.data() + i, min(part, to - i));
+  }
+}
+
+static size_t programmedHalfWords(const std::vector<uint8_t>& image, size_t from, size_t to)
+{
+  size_t n = 0;
+  for (size_t i = from; i < to && i < image.size(); i += 2) {
+    if (image[i] != 0xFF || (i + 1 < image.size() && image[i + 1] != 0xFF)) {
+      n++;
+    }
+  }
+  return n;
+}
+
+static bool locked()
+{
+  return FLASH->CR & FLASH_CR_LOCK;
+}
+
+static void testGeometry()
+{
+  CHECK(simFlash.units() == 8);
+  CHECK(simFlash.unitAt(STORAGE) == 5);
+  CHECK(InternalStorage.maxSize() == 0x20000);
+}
+
+// the sector is erased when the write enters it
+static void testWrite()
+{
+  prepare();
+  std::vector<uint8_t> image = makeImage(100003, 1);
+  CHECK(InternalStorage.open(image.size()));
+  CHECK(!locked());
+  write(image, 0, image.size(), 61);
+  InternalStorage.close();
+  CHECK(locked());
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(simFlash.erases == 1 && simFlash.wear[5] == 1);
+  CHECK(simFlash.programs == (image.size() + 3) / 4 * 2); // words
+  CHECK(simFlash.errors == 0);
+}
+
+// the resume starts at the incomplete word
+static void testResume()
+{
+  prepare();
+  std::vector<uint8_t> image = makeImage(70001, 2);
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, 50001, 64);
+  long offset = InternalStorage.suspend();
+  CHECK(offset == 50000);
+  CHECK(locked());
+  CHECK(InternalStorage.resume(image.size(), offset));
+  write(image, offset, image.size(), 61);
+  InternalStorage.close();
+  CHECK(!memcmp(storage(), image.data(), image.size()));
+  CHECK(simFlash.maxWear() == 1);
+  CHECK(simFlash.errors == 0);
+}
+
+// the copier skips the unchanged sectors and the blank half-words
+static void testApply()
+{
+  simFlash.reset();
+  std::vector<uint8_t> running = makeImage(100000, 3);
+  simFlash.load(0, running.data(), running.size());
+  std::vector<uint8_t> image = running;
+  image[0x4000 + 10] ^= 1; // sector 1
+  memset(image.data() + 0x4000 + 100, 0xFF, 50);
+  image.resize(110000, 0x33); // sector 4
+
+  CHECK(InternalStorage.open(image.size()));
+  write(image, 0, image.size(), 512);
+  InternalStorage.close();
+  unsigned long erases = simFlash.erases;
+  unsigned long programs = simFlash.programs;
+  try {
+    InternalStorage.apply();
+  } catch (SimReset&) {
+  }
+  CHECK(simFlash.resets == 1);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.erases - erases == 2);
+  CHECK(simFlash.wear[0] == 0 && simFlash.wear[1] == 1 && simFlash.wear[2] == 0 && simFlash.wear[4] == 1);
+  CHECK(simFlash.programs - programs == programmedHalfWords(image, 0x4000, 0x8000) + programmedHalfWords(image, 0x10000, 0x20000));
+  CHECK(simFlash.errors == 0);
+  CHECK(locked()); // by the reset
+}
+
+// the model reports the misuse of the flash interface
+static void testModel()
+{
+  simFlash.reset();
+  HAL_FLASH_Unlock();
+  *(volatile uint16_t*) (FLASH_BASE + 0x60000) = 0x1234;
+  while (FLASH->SR & FLASH_SR_BSY);
+  CHECK(simFlash.errors == 2); // both bytes of the x8 parallelism without PG
+  CHECK(simFlash.memory()[0x60000] == 0xFF);
+
+  HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, FLASH_BASE + 0x60000, 0x12345678);
+  HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, FLASH_BASE + 0x60000, 0x12345678);
+  CHECK(simFlash.errors == 3); // not erased
+
+  HAL_FLASH_Lock();
+  FLASH->CR |= FLASH_CR_PG;
+  CHECK(simFlash.errors == 4); // locked
+  CHECK(HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, FLASH_BASE + 0x60004, 0) == HAL_ERROR);
+  CHECK(simFlash.errors == 5);
+}
+
+int main()
+{
+  testGeometry();
+  testWrite();
+  testResume();
+  testApply();
+  testModel();
+  return checkResult();
+}
@@ -0,0 +1,81 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the upload server in the FreeRTOS tasks of startTask(), with the body through the
+// ring buffer to the writer task. built with the thread sanitizer
+
+#include "session.h"
+#include "check.h"
+
+// the tasks of a started server can't be stopped, so every upload has its own server
+static std::shared_ptr<SimConnection> upload(const std::vector<uint8_t>& image, size_t segmentSize, unsigned long idleTimeout = 10000)
+{
+  std::shared_ptr<SimConnection> c = simNetwork.connect(request("POST", "/sketch", toString(image)));
+  c->segmentSize = segmentSize;
+  SimArduinoOTA* ota = new SimArduinoOTA();
+  ota->begin(IPAddress(192, 168, 1, 10), "host", "password", InternalStorage);
+  ota->setIdleTimeout(idleTimeout);
+  CHECK(ota->startTask());
+  simTasksWait(20);
+  delete ota;
+  return c;
+}
+
+static void testUpload()
+{
+  std::vector<uint8_t> image = makeImage(300000, 1);
+  std::shared_ptr<SimConnection> c = upload(image, 1460);
+  CHECK(c->responseCode() == 200);
+  CHECK(simFlash.resets == 1);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.errors == 0);
+}
+
+// reads which don't divide the ring buffer wrap around its end
+static void testWrap()
+{
+  std::vector<uint8_t> image = makeImage(100001, 2);
+  std::shared_ptr<SimConnection> c = upload(image, 999);
+  CHECK(c->responseCode() == 200);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.errors == 0);
+}
+
+// the server task waits with a full ring buffer while the writer task erases
+// a sector longer than the idle timeout. it is not an idle client
+static void testSlowFlash()
+{
+  std::vector<uint8_t> image = makeImage(40000, 3);
+  unsigned long eraseMicros = simFlash.eraseMicros;
+  simFlash.eraseMicros = 30000000;
+  simFlash.hostEraseMicros = 2000;
+  std::shared_ptr<SimConnection> c = upload(image, 1460, 2000);
+  simFlash.eraseMicros = eraseMicros;
+  simFlash.hostEraseMicros = 0;
+  CHECK(c->responseCode() == 200);
+  CHECK(!memcmp(simFlash.memory(), image.data(), image.size()));
+  CHECK(simFlash.errors == 0);
+}
+
+int main()
+{
+  testUpload();
+  testWrap();
+  testSlowFlash();
+  return checkResult();
+}
@@ -0,0 +1,92 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// the idle timeout in the request headers and in the body after a long open()
+
+#include "session.h"
+#include "check.h"
+
+// a storage which erases for a minute in open()
+class SlowStorage : public OTAStorage {
+public:
+  virtual int open(int) {
+    delay(60000);
+    return 1;
+  }
+  virtual size_t write(uint8_t) {return 1;}
+  virtual size_t write(const uint8_t*, size_t size) {return size;}
+  virtual void close() {}
+  virtual void clear() {}
+  virtual void apply() {
+    throw SimReset(); // apply() doesn't return
+  }
+  virtual long maxSize() {return 0x100000;}
+};
+
+static SimArduinoOTA ota;
+
+static std::shared_ptr<SimConnection> upload(size_t size, size_t stallOffset, unsigned long stallMs)
+{
+  std::string r = request("POST", "/sketch", toString(makeImage(size, 1)));
+  std::shared_ptr<SimConnection> c = simNetwork.connect(r);
+  c->stalls.push_back({stallOffset, stallMs});
+  runSession(ota, c);
+  return c;
+}
+
+static void testHeaders()
+{
+  // a pause in the headers shorter than the idle timeout
+  std::shared_ptr<SimConnection> c = upload(10000, 30, 5000);
+  CHECK(c->responseCode() == 200);
+
+  ota.setIdleTimeout(2000);
+  c = upload(10000, 30, 5000);
+  CHECK(c->responseCode() == 408);
+  ota.setIdleTimeout(10000);
+}
+
+static void testSlowOpen()
+{
+  // 2 kB of the body at 20 kB/s after a minute of open(). the throughput of the body
+  // doesn't extend the idle timeout for the pause much
+  std::string r = request("POST", "/sketch", toString(makeImage(10000, 2)));
+  size_t body = r.size() - 10000;
+  std::shared_ptr<SimConnection> c = simNetwork.connect(r);
+  c->bytesPerSecond = 20000;
+  c->stalls.push_back({body, 60000}); // the uploader waits for open()
+  c->stalls.push_back({body + 2048, 15000});
+  runSession(ota, c);
+  CHECK(c->responseCode() == 408);
+
+  c = simNetwork.connect(r);
+  c->bytesPerSecond = 20000;
+  c->stalls.push_back({body, 60000});
+  c->stalls.push_back({body + 2048, 9000});
+  runSession(ota, c);
+  CHECK(c->responseCode() == 200);
+}
+
+int main()
+{
+  SlowStorage storage;
+  ota.begin(IPAddress(192, 168, 1, 10), "host", "password", storage);
+  testHeaders();
+  testSlowOpen();
+  return checkResult();
+}
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+#
+# Uploads only the changed pages of a sketch binary with the ArduinoOTA library.
+#
+#   ota-pages.py 192.168.1.10 sketch.bin [--password password] [--page-size 1024]
+#
+# The CRC-32 of each page of the binary is sent to the board. The board
+# answers with a bitmap of the pages which differ from the running sketch.
+# Then only the changed pages are uploaded with the SHA-256 of the whole
+# binary, which the board checks before it applies the update.
+
+import argparse
+import base64
+import hashlib
+import http.client
+import sys
+import zlib
+
+
+def request(args, path, headers, body):
+    auth = base64.b64encode(('arduino:' + args.password).encode()).decode()
+    headers['Authorization'] = 'Basic ' + auth
+    headers['Content-Length'] = str(len(body))
+    connection = http.client.HTTPConnection(args.address, args.port, timeout=60)
+    connection.request('POST', path, body, headers)
+    response = connection.getresponse()
+    response.read()
+    connection.close()
+    if response.status != 200:
+        sys.exit('%s failed: %d %s' % (path, response.status, response.reason))
+    return response
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Uploads the changed pages of a sketch binary')
+    parser.add_argument('address', help='IP address of the board')
+    parser.add_argument('binary', help='the sketch binary')
+    parser.add_argument('--port', type=int, default=65280)
+    parser.add_argument('--password', default='password')
+    parser.add_argument('--page-size', type=int, default=1024)
+    args = parser.parse_args()
+
+    with open(args.binary, 'rb') as f:
+        image = f.read()
+    size = args.page_size
+    pages = [image[i:i + size] for i in range(0, len(image), size)]
+
+    hashes = b''.join(zlib.crc32(page).to_bytes(4, 'little') for page in pages)
+    response = request(args, '/sketch/pages', {
+        'X-OTA-Length': str(len(image)),
+        'X-OTA-Page-Size': str(size)}, hashes)
+    bitmap = bytes.fromhex(response.getheader('X-OTA-Pages'))
+
+    changed = [page for i, page in enumerate(pages) if bitmap[i // 8] & (1 << (i % 8))]
+    print('%d of %d pages changed' % (len(changed), len(pages)))
+    if not changed:
+        return
+    request(args, '/sketch', {
+        'Content-Encoding': 'x-ota-pages',
+        'X-OTA-Length': str(len(image)),
+        'X-OTA-SHA256': hashlib.sha256(image).hexdigest()}, b''.join(changed))
+    print('done')
+
+
+if __name__ == '__main__':
+    main()
@@ -52,6 +52,7 @@ class ArduinoOTAClass : public WiFiOTAClass {
 
 private:
   NetServer server;
+  NetClient client;
 
 public:
   ArduinoOTAClass() : server(OTA_PORT) {};
@@ -72,10 +73,30 @@ public:
   }
 
   void poll() {
-    NetClient client = server.available();
+    if (!isSessionActive()) {
+      client = server.available();
+    }
     pollServer(client);
   }
 
+#if OTA_TASK
+  // runs poll() in a FreeRTOS task on `core` and writes the upload to the storage
+  // in a second task with a higher priority on the same core. don't call poll() after it
+  bool startTask(int core = OTA_TASK_CORE) {
+    return WiFiOTAClass::startTasks(pollTask, this, core);
+  }
+
+private:
+  static void pollTask(void* ota) {
+    while (true) {
+      ((ArduinoOTAClass*) ota)->poll();
+      delay(((ArduinoOTAClass*) ota)->isSessionActive() ? 1 : 10);
+    }
+  }
+
+public:
+#endif
+
   void handle() { // alias
     poll();
   }
@@ -101,6 +122,7 @@ public:
   }
 
   void end() {
+    WiFiOTAClass::sendMdnsGoodbye(mdnsSocket);
     ArduinoOTAClass<NetServer, NetClient>::end();
     mdnsSocket.stop();
   }
@@ -110,6 +132,22 @@ public:
     WiFiOTAClass::pollMdns(mdnsSocket);
   }
 
+#if OTA_TASK
+  bool startTask(int core = OTA_TASK_CORE) {
+    return WiFiOTAClass::startTasks(pollTask, this, core);
+  }
+
+private:
+  static void pollTask(void* ota) {
+    while (true) {
+      ((ArduinoOTAMdnsClass*) ota)->poll();
+      delay(((ArduinoOTAMdnsClass*) ota)->isSessionActive() ? 1 : 10);
+    }
+  }
+
+public:
+#endif
+
   void handle() { // alias
     poll();
   }
@@ -26,14 +26,24 @@
 #include <Arduino.h>
 
 #include "InternalStorage.h"
+#include "utility/trace.h"
 
-InternalStorageClass::InternalStorageClass() :
-  MAX_PARTIONED_SKETCH_SIZE((MAX_FLASH - SKETCH_START_ADDRESS) / 2),
-  STORAGE_START_ADDRESS(SKETCH_START_ADDRESS + MAX_PARTIONED_SKETCH_SIZE)
+InternalStorageClass::InternalStorageClass()
 {
   pageAlignedLength = 0;
   _writeIndex = 0;
   _writeAddress = nullptr;
+#if defined(__SAMD51__)
+  eraseSize = (PAGE_SIZE * NVMCTRL->PARAM.bit.NVMP) / 64; // block
+#elif defined(ARDUINO_ARCH_SAMD)
+  eraseSize = PAGE_SIZE * 4; // row
+#else
+  eraseSize = PAGE_SIZE;
+#endif
+  // the storage must start at an erase unit, which is erased when the write address enters it
+  STORAGE_START_ADDRESS = SKETCH_START_ADDRESS + (MAX_FLASH - SKETCH_START_ADDRESS) / 2;
+  STORAGE_START_ADDRESS = ((STORAGE_START_ADDRESS + eraseSize - 1) / eraseSize) * eraseSize;
+  MAX_PARTIONED_SKETCH_SIZE = MAX_FLASH - STORAGE_START_ADDRESS;
 }
 
 void InternalStorageClass::debugPrint() {
@@ -117,17 +127,36 @@ extern "C" {
   }
 
   __attribute__ ((long_call, noinline, section (".data#")))
-  static void copyFlashAndReset(int dest, int src, int length, int pageSize)
+  static void copyFlashAndReset(int dest, int src, int length, int pageSize, int eraseSize)
   {
-    volatile uint32_t* d = (volatile uint32_t*)dest;
-    uint32_t* s = (uint32_t*)src;
-
-    eraseFlash(dest, length, pageSize);
-
-    for (int i = 0; i < length; i += 4) {
-      *d++ = *s++;
-
-      waitForReady();
+    // unchanged erase units are skipped and blank pages are not written
+    for (int unit = 0; unit < length; unit += eraseSize) {
+      volatile uint32_t* d = (volatile uint32_t*)(dest + unit);
+      uint32_t* s = (uint32_t*)(src + unit);
+      int words = ((length - unit < eraseSize) ? length - unit : eraseSize) / 4;
+
+      int i = 0;
+      while (i < words && d[i] == s[i]) {
+        i++;
+      }
+      if (i == words)
+        continue;
+
+      eraseFlash(dest + unit, eraseSize, pageSize);
+
+      for (int page = 0; page < words; page += pageSize / 4) {
+        i = 0;
+        while (i < pageSize / 4 && s[page + i] == 0xFFFFFFFF) {
+          i++;
+        }
+        if (i == pageSize / 4)
+          continue;
+        for (i = 0; i < pageSize / 4; i++) {
+          d[page + i] = s[page + i];
+
+          waitForReady();
+        }
+      }
     }
 
     NVIC_SystemReset();
@@ -136,13 +165,18 @@ extern "C" {
 
 int InternalStorageClass::open(int length)
 {
-  if (length > MAX_PARTIONED_SKETCH_SIZE)
+  return resume(length, 0);
+}
+
+int InternalStorageClass::resume(int length, long offset)
+{
+  if (length < 0 || (uint32_t) length > MAX_PARTIONED_SKETCH_SIZE)
     return 0;
 
   pageAlignedLength = ((length / PAGE_SIZE) + 1) * PAGE_SIZE; // align to page up
 
   _writeIndex = 0;
-  _writeAddress = (uint32_t*)STORAGE_START_ADDRESS;
+  _writeAddress = (uint32_t*)(STORAGE_START_ADDRESS + offset);
 
 #if defined(__SAMD51__)
   // Enable auto dword writes
@@ -156,28 +190,49 @@ int InternalStorageClass::open(int length)
   NVMCTRL->CTRLB.bit.MANW = 0;
 #endif
 
-#if !defined(ARDUINO_ARCH_NRF5)
-  // Erase all pages
-  eraseFlash(STORAGE_START_ADDRESS, pageAlignedLength, PAGE_SIZE);
-#endif
+  // the erase units are erased in write() when the write address enters them
 
   return 1;
 }
 
+long InternalStorageClass::suspend()
+{
+  // the data in the page buffer are not written to flash yet. resume from
+  // the start of the erase unit, which is erased again when entered
+  uint32_t written = (_writeAddress - (uint32_t*)STORAGE_START_ADDRESS) * sizeof(uint32_t);
+  _writeIndex = 0;
+  return (written / eraseSize) * eraseSize;
+}
+
 size_t InternalStorageClass::write(uint8_t b)
 {
-  _addressData.u8[_writeIndex] = b;
-  _writeIndex++;
+  return write(&b, 1);
+}
 
-  if (_writeIndex == 4) {
-    _writeIndex = 0;
+size_t InternalStorageClass::write(const uint8_t* buffer, size_t size)
+{
+  const uint8_t* end = buffer + size;
+
+  while (buffer < end) {
+    if (_writeIndex == 0 && end - buffer >= 4) {
+      memcpy(_addressData.u8, buffer, 4); // buffer may be unaligned
+      buffer += 4;
+    } else {
+      _addressData.u8[_writeIndex] = *buffer++;
+      _writeIndex++;
+      if (_writeIndex < 4)
+        continue;
+      _writeIndex = 0;
+    }
 
-#if defined(ARDUINO_ARCH_NRF5)
-    // Erase a single page if needed
-    if ((int)(_writeAddress) % PAGE_SIZE == 0) {
-      eraseFlash((int)_writeAddress, PAGE_SIZE, PAGE_SIZE);
+    // Erase the next row, block or page ahead of the write
+    if ((uint32_t) (uintptr_t) _writeAddress % eraseSize == 0) {
+      unsigned long t = micros();
+      OTA_TRACE_EVENT(TRACE_ERASE_START, (uint32_t) (uintptr_t) _writeAddress);
+      eraseFlash((int) (uintptr_t) _writeAddress, eraseSize, PAGE_SIZE);
+      OTA_TRACE_EVENT(TRACE_ERASE_END, (uint32_t) (uintptr_t) _writeAddress);
+      eraseMicros += micros() - t;
     }
-#endif
 
     *_writeAddress = _addressData.u32;
 
@@ -186,13 +241,15 @@ size_t InternalStorageClass::write(uint8_t b)
     waitForReady();
   }
 
-  return 1;
+  return size;
 }
 
 void InternalStorageClass::close()
 {
-  while ((int)_writeAddress % PAGE_SIZE) {
-    write(0xff);
+  static const uint8_t padding[4] = {0xff, 0xff, 0xff, 0xff};
+
+  while (_writeIndex || (int) (uintptr_t) _writeAddress % PAGE_SIZE) {
+    write(padding, 4 - _writeIndex); // completes a word
   }
 
   // Re-calculate pageAlignedLength in case the actually written binary
@@ -204,12 +261,18 @@ void InternalStorageClass::clear()
 {
 }
 
+size_t InternalStorageClass::read(long offset, uint8_t* buffer, size_t size)
+{
+  memcpy(buffer, (const uint8_t*) STORAGE_START_ADDRESS + offset, size);
+  return size;
+}
+
 void InternalStorageClass::apply()
 {
   // disable interrupts, as vector table will be erase during flash sequence
   noInterrupts();
 
-  copyFlashAndReset(SKETCH_START_ADDRESS, STORAGE_START_ADDRESS, pageAlignedLength, PAGE_SIZE);
+  copyFlashAndReset(SKETCH_START_ADDRESS, STORAGE_START_ADDRESS, pageAlignedLength, PAGE_SIZE, eraseSize);
 }
 
 long InternalStorageClass::maxSize()
@@ -33,15 +33,21 @@ public:
 
   virtual int open(int length);
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t* buffer, size_t size);
   virtual void close();
   virtual void clear();
   virtual void apply();
   virtual long maxSize();
+  virtual long suspend();
+  virtual int resume(int length, long offset);
+  virtual bool canResume() {return true;}
+  virtual size_t read(long offset, uint8_t* buffer, size_t size);
 
   void debugPrint();
 
 private:
-  const uint32_t MAX_PARTIONED_SKETCH_SIZE, STORAGE_START_ADDRESS;
+  uint32_t MAX_PARTIONED_SKETCH_SIZE, STORAGE_START_ADDRESS;
+  uint32_t eraseSize;
 
   union {
     uint32_t u32;
@@ -22,6 +22,19 @@
 
 #include "InternalStorageAVR.h"
 #include "utility/optiboot.h"
+#include "utility/trace.h"
+
+static bool isSamePage(uint32_t address1, uint32_t address2) {
+  for (uint16_t i = 0; i < SPM_PAGESIZE; i++) {
+#ifdef RAMPZ
+    if (pgm_read_byte_far(address1 + i) != pgm_read_byte_far(address2 + i))
+#else
+    if (pgm_read_byte(address1 + i) != pgm_read_byte(address2 + i))
+#endif
+      return false;
+  }
+  return true;
+}
 
 InternalStorageAVRClass::InternalStorageAVRClass() {
   maxSketchSize = (MAX_FLASH - bootloaderSize) / 2;
@@ -38,20 +51,32 @@ int InternalStorageAVRClass::open(int length) {
 }
 
 size_t InternalStorageAVRClass::write(uint8_t b) {
-  if (pageIndex == 0) {
-    optiboot_page_erase(pageAddress);
-  }
-  dataWord.u8[pageIndex % 2] = b;
-  if (pageIndex % 2) {
-    optiboot_page_fill(pageAddress + pageIndex, dataWord.u16);
-  }
-  pageIndex++;
-  if (pageIndex == SPM_PAGESIZE) {
-    optiboot_page_write(pageAddress);
-    pageIndex = 0;
-    pageAddress += SPM_PAGESIZE;
+  return write(&b, 1);
+}
+
+size_t InternalStorageAVRClass::write(const uint8_t* buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (pageIndex == 0) {
+      unsigned long t = micros();
+      OTA_TRACE_EVENT(TRACE_ERASE_START, pageAddress);
+      optiboot_page_erase(pageAddress);
+      OTA_TRACE_EVENT(TRACE_ERASE_END, pageAddress);
+      eraseMicros += micros() - t;
+    }
+    dataWord.u8[pageIndex % 2] = buffer[i];
+    if (pageIndex % 2) {
+      optiboot_page_fill(pageAddress + pageIndex, dataWord.u16);
+    }
+    pageIndex++;
+    if (pageIndex == SPM_PAGESIZE) {
+      OTA_TRACE_EVENT(TRACE_PROGRAM_START, pageAddress);
+      optiboot_page_write(pageAddress);
+      OTA_TRACE_EVENT(TRACE_PROGRAM_END, pageAddress);
+      pageIndex = 0;
+      pageAddress += SPM_PAGESIZE;
+    }
   }
-  return 1;
+  return size;
 }
 
 void InternalStorageAVRClass::close() {
@@ -65,7 +90,47 @@ void InternalStorageAVRClass::clear() {
 }
 
 void InternalStorageAVRClass::apply() {
-  copy_flash_pages_cli(SKETCH_START_ADDRESS, maxSketchSize, (pageAddress - maxSketchSize) / SPM_PAGESIZE + 1, true);
+  uint32_t dest = SKETCH_START_ADDRESS;
+  uint32_t src = maxSketchSize;
+  uint16_t pageCount = (pageAddress - maxSketchSize) / SPM_PAGESIZE + 1;
+
+  // the bootloader copies a continuous range of pages,
+  // so only the unchanged pages at the start and at the end are skipped
+  while (pageCount > 1 && isSamePage(dest, src)) {
+    dest += SPM_PAGESIZE;
+    src += SPM_PAGESIZE;
+    pageCount--;
+  }
+  while (pageCount > 1 && isSamePage(dest + (uint32_t) (pageCount - 1) * SPM_PAGESIZE, src + (uint32_t) (pageCount - 1) * SPM_PAGESIZE)) {
+    pageCount--;
+  }
+
+  copy_flash_pages_cli(dest, src, pageCount, true);
+}
+
+long InternalStorageAVRClass::suspend() {
+  pageIndex = 0; // the partially filled page is written again after resume
+  return pageAddress - maxSketchSize;
+}
+
+int InternalStorageAVRClass::resume(int length, long offset) {
+  if (length < 0 || (uint32_t) length > maxSketchSize)
+    return 0;
+  pageAddress = maxSketchSize + offset;
+  pageIndex = 0;
+  return 1;
+}
+
+size_t InternalStorageAVRClass::read(long offset, uint8_t* buffer, size_t size) {
+  uint32_t address = maxSketchSize + offset;
+  for (size_t i = 0; i < size; i++) {
+#ifdef RAMPZ
+    buffer[i] = pgm_read_byte_far(address + i);
+#else
+    buffer[i] = pgm_read_byte(address + i);
+#endif
+  }
+  return size;
 }
 
 long InternalStorageAVRClass::maxSize() {
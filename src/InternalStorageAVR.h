@@ -29,10 +29,15 @@ public:
 
   virtual int open(int length);
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t* buffer, size_t size);
   virtual void close();
   virtual void clear();
   virtual void apply();
   virtual long maxSize();
+  virtual long suspend();
+  virtual int resume(int length, long offset);
+  virtual bool canResume() {return true;}
+  virtual size_t read(long offset, uint8_t* buffer, size_t size);
 
 private:
   uint32_t maxSketchSize;
@@ -44,6 +44,11 @@ size_t InternalStorageESPClass::write(uint8_t b)
   return Update.write(&b, 1);
 }
 
+size_t InternalStorageESPClass::write(const uint8_t* buffer, size_t size)
+{
+  return Update.write(const_cast<uint8_t*>(buffer), size);
+}
+
 void InternalStorageESPClass::close()
 {
   Update.end(false);
@@ -25,68 +25,94 @@
 
 #include <hardware/flash.h>
 #include "utility/rp2_flash_boot.h"
+#include "utility/trace.h"
+
+// the data are programmed in whole sectors, so the other core is idled
+// and the interrupts are disabled once for the erase and the programming
+static uint8_t sectorBuffer[OTA_RP2_WRITE_SECTORS * FLASH_SECTOR_SIZE];
 
 InternalStorageRP2Class::InternalStorageRP2Class() {
   maxSketchSize = MAX_FLASH / 2;
   maxSketchSize = (maxSketchSize / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE; // align to sector
   sectorAlignedLength = 0;
-  pageBuffer = nullptr;
-  pageBufferIndex = 0;
+  bufferIndex = 0;
   flashWriteIndex = maxSketchSize;
 }
 
 int InternalStorageRP2Class::open(int length) {
+  return resume(length, 0);
+}
 
-  if (length > maxSketchSize)
-    return 0;
+size_t InternalStorageRP2Class::write(uint8_t b) {
+  return write(&b, 1);
+}
 
-  sectorAlignedLength = ((length / FLASH_SECTOR_SIZE) + 1) * FLASH_SECTOR_SIZE; // align to sector up
+size_t InternalStorageRP2Class::write(const uint8_t* buffer, size_t size) {
 
-  noInterrupts();
-  rp2040.idleOtherCore();
-  flash_range_erase(maxSketchSize, sectorAlignedLength);
-  rp2040.resumeOtherCore();
-  interrupts();
+  size_t written = 0;
+  while (written < size) {
+    size_t l = min(sizeof(sectorBuffer) - bufferIndex, size - written);
+    memcpy(sectorBuffer + bufferIndex, buffer + written, l);
+    bufferIndex += l;
+    written += l;
 
-  pageBufferIndex = 0;
-  flashWriteIndex = maxSketchSize;
+    if (bufferIndex == sizeof(sectorBuffer)) {
+      writeSectors();
+    }
+  }
 
-  return 1;
+  return size;
 }
 
-size_t InternalStorageRP2Class::write(uint8_t b) {
-
-  if (pageBuffer == nullptr) {
-    pageBuffer = new uint8_t[PAGE_SIZE];
-    if (pageBuffer == nullptr)
-      return 0;
+void InternalStorageRP2Class::close() {
+  if (bufferIndex > 0) {
+    writeSectors();
   }
+  // only the written sectors were erased
+  sectorAlignedLength = ((flashWriteIndex - maxSketchSize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+}
 
-  pageBuffer[pageBufferIndex++] = b;
+// the last part written from close() is padded to a whole page
+void InternalStorageRP2Class::writeSectors() {
+  uint32_t length = ((bufferIndex + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE) * FLASH_PAGE_SIZE;
+  memset(sectorBuffer + bufferIndex, 0xFF, length - bufferIndex);
+  uint32_t eraseLength = ((length + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
 
-  if (pageBufferIndex == PAGE_SIZE) {
-    noInterrupts();
-    rp2040.idleOtherCore();
-    flash_range_program(flashWriteIndex, pageBuffer, PAGE_SIZE);
-    rp2040.resumeOtherCore();
-    interrupts();
-    pageBufferIndex = 0;
-    flashWriteIndex += PAGE_SIZE;
-  }
+  noInterrupts();
+  rp2040.idleOtherCore();
+  unsigned long t = micros();
+  OTA_TRACE_EVENT(TRACE_ERASE_START, flashWriteIndex);
+  flash_range_erase(flashWriteIndex, eraseLength);
+  OTA_TRACE_EVENT(TRACE_ERASE_END, flashWriteIndex);
+  eraseMicros += micros() - t;
+  OTA_TRACE_EVENT(TRACE_PROGRAM_START, flashWriteIndex);
+  flash_range_program(flashWriteIndex, sectorBuffer, length);
+  OTA_TRACE_EVENT(TRACE_PROGRAM_END, flashWriteIndex);
+  rp2040.resumeOtherCore();
+  interrupts();
+  bufferIndex = 0;
+  flashWriteIndex += length;
+}
+
+long InternalStorageRP2Class::suspend() {
+  bufferIndex = 0; // the buffered data are written again after resume
+  return flashWriteIndex - maxSketchSize;
+}
 
+int InternalStorageRP2Class::resume(int length, long offset) {
+  if (length < 0 || (uint32_t) length > maxSketchSize || offset < 0 || offset > length)
+    return 0;
+  sectorAlignedLength = ((length / FLASH_SECTOR_SIZE) + 1) * FLASH_SECTOR_SIZE; // align to sector up
+  // the buffer starts at a sector. the part of the sector before the offset is kept
+  bufferIndex = offset % FLASH_SECTOR_SIZE;
+  flashWriteIndex = maxSketchSize + offset - bufferIndex;
+  memcpy(sectorBuffer, (const uint8_t*) XIP_BASE + flashWriteIndex, bufferIndex);
   return 1;
 }
 
-void InternalStorageRP2Class::close() {
-  if (pageBufferIndex > 0) {
-    memset(pageBuffer + pageBufferIndex, PAGE_SIZE - pageBufferIndex, 0xFF);
-    noInterrupts();
-    rp2040.idleOtherCore();
-    flash_range_program(flashWriteIndex, pageBuffer, PAGE_SIZE);
-    rp2040.resumeOtherCore();
-    interrupts();
-    pageBufferIndex = 0;
-  }
+size_t InternalStorageRP2Class::read(long offset, uint8_t* buffer, size_t size) {
+  memcpy(buffer, (const uint8_t*) XIP_BASE + maxSketchSize + offset, size);
+  return size;
 }
 
 void InternalStorageRP2Class::apply() {
@@ -22,6 +22,10 @@
 
 #include "OTAStorage.h"
 
+#ifndef OTA_RP2_WRITE_SECTORS // count of 4 kB sectors buffered and programmed at once
+#define OTA_RP2_WRITE_SECTORS 1
+#endif
+
 class InternalStorageRP2Class : public OTAStorage {
 public:
 
@@ -29,17 +33,23 @@ public:
 
   virtual int open(int length);
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t* buffer, size_t size);
   virtual void close();
   virtual void clear() {}
   virtual void apply();
   virtual long maxSize() {return maxSketchSize;}
+  virtual long suspend();
+  virtual int resume(int length, long offset);
+  virtual bool canResume() {return true;}
+  virtual size_t read(long offset, uint8_t* buffer, size_t size);
 
 private:
+  void writeSectors();
+
   uint32_t maxSketchSize;
   uint32_t sectorAlignedLength;
-  uint8_t* pageBuffer;
-  uint16_t pageBufferIndex;
-  uint32_t flashWriteIndex;
+  uint32_t bufferIndex;
+  uint32_t flashWriteIndex; // of the start of the buffer
 };
 
 extern InternalStorageRP2Class InternalStorage;
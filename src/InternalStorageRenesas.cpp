@@ -22,6 +22,7 @@
 #include <Arduino.h>
 
 #include "InternalStorageRenesas.h"
+#include "utility/trace.h"
 extern "C" {
 #include "utility/r_flash_lp_cf.h"
 }
@@ -64,21 +65,36 @@ extern "C" {
 PLACE_IN_RAM_SECTION
 static void copyFlashAndReset(uint32_t dest, uint32_t src, uint32_t length, uint32_t pageSize) {
 
-  uint32_t pageCount = (length / pageSize) + 1; // align to page up
   const uint16_t buffSize = 16 * FLASH_WRITE_SIZE;
   uint8_t buff[buffSize];
-  uint8_t* s = (uint8_t*) src;
+  fsp_err_t rv = FSP_SUCCESS;
 
-  fsp_err_t rv = r_flash_lp_cf_erase(&flashCtrl, dest, pageCount, pageSize);
+  // unchanged blocks are skipped and blank parts are not written
+  for (uint32_t block = 0; rv == FSP_SUCCESS && block < length; block += pageSize) {
+    const uint8_t* s = (const uint8_t*) (src + block);
+    const uint8_t* d = (const uint8_t*) (dest + block);
 
-  while (rv == FSP_SUCCESS && length > 0) {
-    for (uint16_t i = 0; i < buffSize; i++) {
-      buff[i] = *s;
-      s++;
+    uint32_t i = 0;
+    while (i < pageSize && d[i] == s[i]) {
+      i++;
+    }
+    if (i == pageSize)
+      continue;
+
+    rv = r_flash_lp_cf_erase(&flashCtrl, dest + block, 1, pageSize);
+
+    for (uint32_t offs = 0; rv == FSP_SUCCESS && offs < pageSize; offs += buffSize) {
+      bool blank = true;
+      for (uint16_t j = 0; j < buffSize; j++) {
+        buff[j] = s[offs + j];
+        if (buff[j] != 0xFF) {
+          blank = false;
+        }
+      }
+      if (!blank) {
+        rv = r_flash_lp_cf_write(&flashCtrl, (uint32_t) &buff, dest + block + offs, buffSize);
+      }
     }
-    rv = r_flash_lp_cf_write(&flashCtrl, (uint32_t) &buff, dest, buffSize);
-    dest += buffSize;
-    length -= buffSize;
   }
 
   NVIC_SystemReset();
@@ -87,49 +103,88 @@ static void copyFlashAndReset(uint32_t dest, uint32_t src, uint32_t length, uint
 }
 
 int InternalStorageRenesasClass::open(int length) {
+  return resume(length, 0);
+}
 
-  if (length > maxSketchSize)
-    return 0;
+size_t InternalStorageRenesasClass::write(uint8_t b) {
+  return write(&b, 1);
+}
 
-  uint32_t pageCount = (length / PAGE_SIZE) + 1; // align to page up
-  pageAlignedLength = pageCount * PAGE_SIZE;
-  flashWriteAddress = storageStartAddress;
-  writeIndex = 0;
+size_t InternalStorageRenesasClass::write(const uint8_t* data, size_t size) {
 
-  fsp_err_t rv = R_FLASH_LP_Open(&flashCtrl, &flashCfg);
-  if (rv != FSP_SUCCESS)
-    return 0;
+  size_t written = 0;
+  while (written < size) {
+    uint16_t l = min((size_t) (sizeof(buffer) - writeIndex), size - written);
+    memcpy(buffer + writeIndex, data + written, l);
+    writeIndex += l;
+    written += l;
+
+    if (writeIndex == sizeof(buffer)) {
+      if (!flushBuffer())
+        return 0;
+    }
+  }
+  return size;
+}
 
+bool InternalStorageRenesasClass::flushBuffer() {
+  if (writeIndex % FLASH_WRITE_SIZE) {
+    memset(buffer + writeIndex, 0xff, FLASH_WRITE_SIZE - (writeIndex % FLASH_WRITE_SIZE));
+    writeIndex += FLASH_WRITE_SIZE - (writeIndex % FLASH_WRITE_SIZE);
+  }
+  fsp_err_t rv = FSP_SUCCESS;
   __disable_irq();
-  rv = r_flash_lp_cf_erase(&flashCtrl, storageStartAddress, pageCount, PAGE_SIZE);
+  if ((flashWriteAddress - storageStartAddress) % PAGE_SIZE == 0) { // the block is erased when entered
+    unsigned long t = micros();
+    OTA_TRACE_EVENT(TRACE_ERASE_START, flashWriteAddress);
+    rv = r_flash_lp_cf_erase(&flashCtrl, flashWriteAddress, 1, PAGE_SIZE);
+    OTA_TRACE_EVENT(TRACE_ERASE_END, flashWriteAddress);
+    eraseMicros += micros() - t;
+  }
+  if (rv == FSP_SUCCESS) {
+    OTA_TRACE_EVENT(TRACE_PROGRAM_START, flashWriteAddress);
+    rv = r_flash_lp_cf_write(&flashCtrl, (uint32_t) &buffer, flashWriteAddress, writeIndex);
+    OTA_TRACE_EVENT(TRACE_PROGRAM_END, flashWriteAddress);
+  }
   __enable_irq();
+  if (rv != FSP_SUCCESS)
+    return false;
+  flashWriteAddress += writeIndex;
+  writeIndex = 0;
+  return true;
+}
 
-  return (rv == FSP_SUCCESS);
+void InternalStorageRenesasClass::close() {
+  if (writeIndex) {
+    flushBuffer();
+  }
+  R_FLASH_LP_Close(&flashCtrl);
+  // only the written blocks were erased
+  uint32_t written = flashWriteAddress - storageStartAddress;
+  pageAlignedLength = ((written + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
 }
 
-size_t InternalStorageRenesasClass::write(uint8_t b) {
+long InternalStorageRenesasClass::suspend() {
+  R_FLASH_LP_Close(&flashCtrl);
+  writeIndex = 0; // the buffered data are written again after resume
+  return flashWriteAddress - storageStartAddress;
+}
 
-  buffer[writeIndex] = b;
-  writeIndex++;
+int InternalStorageRenesasClass::resume(int length, long offset) {
 
-  if (writeIndex == FLASH_WRITE_SIZE) {
-    writeIndex = 0;
+  if (length < 0 || (uint32_t) length > maxSketchSize)
+    return 0;
 
-    __disable_irq();
-    fsp_err_t rv = r_flash_lp_cf_write(&flashCtrl, (uint32_t) &buffer, flashWriteAddress, FLASH_WRITE_SIZE);
-    __enable_irq();
-    if (rv != FSP_SUCCESS)
-      return 0;
-    flashWriteAddress += FLASH_WRITE_SIZE;
-  }
-  return 1;
+  pageAlignedLength = ((length / PAGE_SIZE) + 1) * PAGE_SIZE; // align to page up
+  flashWriteAddress = storageStartAddress + offset;
+  writeIndex = 0;
+
+  return (R_FLASH_LP_Open(&flashCtrl, &flashCfg) == FSP_SUCCESS);
 }
 
-void InternalStorageRenesasClass::close() {
-  while (writeIndex) {
-    write(0xff);
-  }
-  R_FLASH_LP_Close(&flashCtrl);
+size_t InternalStorageRenesasClass::read(long offset, uint8_t* buffer, size_t size) {
+  memcpy(buffer, (const uint8_t*) storageStartAddress + offset, size);
+  return size;
 }
 
 void InternalStorageRenesasClass::apply() {
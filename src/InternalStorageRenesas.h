@@ -32,22 +32,28 @@ public:
 
   virtual int open(int length);
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t* buffer, size_t size);
   virtual void close();
   virtual void clear() {}
   virtual void apply();
   virtual long maxSize() {return maxSketchSize;}
+  virtual long suspend();
+  virtual int resume(int length, long offset);
+  virtual bool canResume() {return true;}
+  virtual size_t read(long offset, uint8_t* buffer, size_t size);
 
   void debugPrint();
 
 
 private:
+  bool flushBuffer();
 
-  uint8_t buffer[FLASH_WRITE_SIZE];
+  uint8_t buffer[16 * FLASH_WRITE_SIZE];
 
   uint32_t maxSketchSize;
   uint32_t storageStartAddress;
   uint32_t pageAlignedLength;
-  uint8_t writeIndex;
+  uint16_t writeIndex;
   uint32_t flashWriteAddress;
 };
 
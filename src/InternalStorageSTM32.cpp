@@ -27,6 +27,7 @@
 
 #include "InternalStorageSTM32.h"
 #include "utility/stm32_flash_boot.h"
+#include "utility/trace.h"
 
 #if defined(STM32F7xx)
 const uint32_t SECTOR_SIZE = 0x40000; // from sector 5
@@ -38,6 +39,7 @@ InternalStorageSTM32Class::InternalStorageSTM32Class(uint8_t _sector) {
   sector = _sector < 5 ? 5 : _sector;
 #ifdef FLASH_TYPEERASE_SECTORS
   maxSketchSize = SECTOR_SIZE * (sector - 4); // sum of sectors 0 to 4 is 128kB, starting sector 5 the sector size is 128kB
+  eraseSize = SECTOR_SIZE;
   storageStartAddress = FLASH_BASE + maxSketchSize;
   maxSketchSize -= SKETCH_START_ADDRESS;
   if (MAX_FLASH - maxSketchSize < maxSketchSize) {
@@ -47,6 +49,7 @@ InternalStorageSTM32Class::InternalStorageSTM32Class(uint8_t _sector) {
   maxSketchSize = (MAX_FLASH - SKETCH_START_ADDRESS) / 2;
   maxSketchSize = (maxSketchSize / PAGE_SIZE) * PAGE_SIZE; // align to page
   storageStartAddress = FLASH_BASE + SKETCH_START_ADDRESS + maxSketchSize;
+  eraseSize = PAGE_SIZE;
 #endif
   pageAlignedLength = 0;
   writeIndex = 0;
@@ -54,54 +57,98 @@ InternalStorageSTM32Class::InternalStorageSTM32Class(uint8_t _sector) {
 }
 
 int InternalStorageSTM32Class::open(int length) {
+  return resume(length, 0);
+}
 
-  if (length > maxSketchSize)
-    return 0;
-
-  pageAlignedLength = ((length / PAGE_SIZE) + 1) * PAGE_SIZE; // align to page up
-  flashWriteAddress = storageStartAddress;
-  writeIndex = 0;
-
+// erases the sector or page at address
+bool InternalStorageSTM32Class::erase(uint32_t address) {
   FLASH_EraseInitTypeDef EraseInitStruct;
 #ifdef FLASH_TYPEERASE_SECTORS
   EraseInitStruct.TypeErase = FLASH_TYPEERASE_SECTORS;
-  EraseInitStruct.Sector = sector;
-  EraseInitStruct.NbSectors = 1 + (length / SECTOR_SIZE);
+  EraseInitStruct.Sector = sector + (address - storageStartAddress) / SECTOR_SIZE;
+  EraseInitStruct.NbSectors = 1;
   EraseInitStruct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
 #else
   EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
-  EraseInitStruct.PageAddress = flashWriteAddress;
-  EraseInitStruct.NbPages = pageAlignedLength / PAGE_SIZE;
+  EraseInitStruct.PageAddress = address;
+  EraseInitStruct.NbPages = 1;
 #endif
 #ifdef FLASH_BANK_1
   EraseInitStruct.Banks = FLASH_BANK_1;
 #endif
 
   uint32_t pageError = 0;
-  return (HAL_FLASH_Unlock() == HAL_OK //
-    && HAL_FLASHEx_Erase(&EraseInitStruct, &pageError) == HAL_OK);
+  return (HAL_FLASHEx_Erase(&EraseInitStruct, &pageError) == HAL_OK);
 }
 
 size_t InternalStorageSTM32Class::write(uint8_t b) {
+  return write(&b, 1);
+}
 
-  addressData.u8[writeIndex] = b;
-  writeIndex++;
-
-  if (writeIndex == 4) {
-    writeIndex = 0;
-
+size_t InternalStorageSTM32Class::write(const uint8_t* buffer, size_t size) {
+
+  const uint8_t* end = buffer + size;
+
+  while (buffer < end) {
+    if (writeIndex == 0 && end - buffer >= 4) {
+      memcpy(addressData.u8, buffer, 4); // buffer may be unaligned
+      buffer += 4;
+    } else {
+      addressData.u8[writeIndex] = *buffer++;
+      writeIndex++;
+      if (writeIndex < 4)
+        continue;
+      writeIndex = 0;
+    }
+
+    // the sector or page is erased when the write address enters it
+    if ((flashWriteAddress - storageStartAddress) % eraseSize == 0) {
+      unsigned long t = micros();
+      OTA_TRACE_EVENT(TRACE_ERASE_START, flashWriteAddress);
+      if (!erase(flashWriteAddress))
+        return 0;
+      OTA_TRACE_EVENT(TRACE_ERASE_END, flashWriteAddress);
+      eraseMicros += micros() - t;
+    }
     if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, flashWriteAddress, addressData.u32) != HAL_OK)
       return 0;
     flashWriteAddress += 4;
   }
-  return 1;
+  return size;
 }
 
 void InternalStorageSTM32Class::close() {
-  while (writeIndex) {
-    write(0xff);
+  static const uint8_t padding[4] = {0xff, 0xff, 0xff, 0xff};
+  if (writeIndex) {
+    write(padding, 4 - writeIndex);
   }
   HAL_FLASH_Lock();
+  // only the written pages or sectors were erased
+  uint32_t written = flashWriteAddress - storageStartAddress;
+  pageAlignedLength = ((written + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+}
+
+long InternalStorageSTM32Class::suspend() {
+  HAL_FLASH_Lock();
+  writeIndex = 0; // the incomplete word is written again after resume
+  return flashWriteAddress - storageStartAddress;
+}
+
+int InternalStorageSTM32Class::resume(int length, long offset) {
+
+  if (length < 0 || (uint32_t) length > maxSketchSize)
+    return 0;
+
+  pageAlignedLength = ((length / PAGE_SIZE) + 1) * PAGE_SIZE; // align to page up
+  flashWriteAddress = storageStartAddress + offset;
+  writeIndex = 0;
+
+  return (HAL_FLASH_Unlock() == HAL_OK);
+}
+
+size_t InternalStorageSTM32Class::read(long offset, uint8_t* buffer, size_t size) {
+  memcpy(buffer, (const uint8_t*) storageStartAddress + offset, size);
+  return size;
 }
 
 void InternalStorageSTM32Class::apply() {
@@ -29,12 +29,19 @@ public:
 
   virtual int open(int length);
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t* buffer, size_t size);
   virtual void close();
   virtual void clear() {}
   virtual void apply();
   virtual long maxSize() {return maxSketchSize;}
+  virtual long suspend();
+  virtual int resume(int length, long offset);
+  virtual bool canResume() {return true;}
+  virtual size_t read(long offset, uint8_t* buffer, size_t size);
 
 private:
+  bool erase(uint32_t address);
+
   union {
     uint32_t u32;
     uint8_t u8[4];
@@ -43,6 +50,7 @@ private:
   uint8_t sector; // for models with flash organized into sectors
   uint32_t maxSketchSize;
   uint32_t storageStartAddress;
+  uint32_t eraseSize;
   uint32_t pageAlignedLength;
   uint8_t writeIndex;
   uint32_t flashWriteAddress;
@@ -35,7 +35,7 @@ extern "C" uint8_t __ROM_Start;
 
 OTAStorage::OTAStorage() :
 #if defined(ARDUINO_ARCH_SAMD)
-        SKETCH_START_ADDRESS((uint32_t) __text_start__),
+        SKETCH_START_ADDRESS((uint32_t) (uintptr_t) __text_start__),
         PAGE_SIZE(pageSizes[NVMCTRL->PARAM.bit.PSZ]),
         MAX_FLASH(PAGE_SIZE * NVMCTRL->PARAM.bit.NVMP - eepromSizes[EEPROM_EMULATION_RESERVATION])
 #elif defined(ARDUINO_ARCH_NRF5)
@@ -43,7 +43,7 @@ OTAStorage::OTAStorage() :
         PAGE_SIZE((size_t) NRF_FICR->CODEPAGESIZE),
         MAX_FLASH(PAGE_SIZE * (uint32_t) NRF_FICR->CODESIZE)
 #elif defined(ARDUINO_ARCH_STM32)
-        SKETCH_START_ADDRESS((uint32_t) &g_pfnVectors - FLASH_BASE), // start address depends on bootloader size
+        SKETCH_START_ADDRESS((uint32_t) (uintptr_t) &g_pfnVectors - FLASH_BASE), // start address depends on bootloader size
 #ifdef FLASH_PAGE_SIZE
         PAGE_SIZE(FLASH_PAGE_SIZE),
 #else
@@ -53,7 +53,7 @@ OTAStorage::OTAStorage() :
 #elif defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
         SKETCH_START_ADDRESS(0),
         PAGE_SIZE(FLASH_PAGE_SIZE),
-        MAX_FLASH((uint32_t) min(&_FS_start, &_EEPROM_start) - XIP_BASE)
+        MAX_FLASH((uintptr_t) min(&_FS_start, &_EEPROM_start) - XIP_BASE)
 #elif defined(ARDUINO_ARCH_RENESAS_UNO)
         SKETCH_START_ADDRESS((uint32_t)(&__ROM_Start)),
         PAGE_SIZE(BSP_FEATURE_FLASH_LP_CF_BLOCK_SIZE),
@@ -69,6 +69,7 @@ OTAStorage::OTAStorage() :
 #endif
 {
   bootloaderSize = 0;
+  eraseMicros = 0;
 #if defined(__AVR__) && !defined(ARDUINO_ARCH_MEGAAVR)
   cli();
   uint8_t highBits = boot_lock_fuse_bits_get(GET_HIGH_FUSE_BITS);
@@ -80,6 +81,18 @@ OTAStorage::OTAStorage() :
 #endif
 }
 
+const uint8_t* OTAStorage::sketchImage() {
+#if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_NRF5) || defined(ARDUINO_ARCH_RENESAS_UNO)
+  return (const uint8_t*) SKETCH_START_ADDRESS;
+#elif defined(ARDUINO_ARCH_STM32)
+  return (const uint8_t*) (FLASH_BASE + SKETCH_START_ADDRESS);
+#elif defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
+  return (const uint8_t*) (XIP_BASE + SKETCH_START_ADDRESS);
+#else
+  return nullptr; // AVR flash is not in data address space, esp flash is not mapped whole
+#endif
+}
+
 void ExternalOTAStorage::apply() {
 #if defined(ARDUINO_ARCH_MEGAAVR)
   wdt_enable(WDT_PERIOD_8CLK_gc);
@@ -37,19 +37,65 @@ public:
     return open(length);
   }
   virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      if (!write(buffer[i]))
+        return i;
+    }
+    return size;
+  }
   virtual void close() = 0;
   virtual void clear() = 0;
   virtual void apply() = 0;
 
+  // stops an interrupted upload. returns the count of bytes safely stored,
+  // from which the upload can continue after resume()
+  virtual long suspend() {
+    close();
+    clear();
+    return 0;
+  }
+  virtual int resume(int length, long offset) {
+    (void) length;
+    (void) offset;
+    return 0;
+  }
+  // true if suspend() keeps the stored part for resume()
+  virtual bool canResume() {
+    return false;
+  }
+  // reads back the stored part after resume(), for the checksums of the whole binary.
+  // returns the count of read bytes, 0 if the storage can't read it
+  virtual size_t read(long offset, uint8_t* buffer, size_t size) {
+    (void) offset;
+    (void) buffer;
+    (void) size;
+    return 0;
+  }
+
   virtual long maxSize() {
     return (MAX_FLASH - SKETCH_START_ADDRESS - bootloaderSize);
   }
 
+  // the running sketch in memory-mapped flash as source for delta updates.
+  // returns nullptr if the flash can't be read directly
+  virtual const uint8_t* sketchImage();
+  virtual long sketchImageSize() {
+    return (MAX_FLASH - SKETCH_START_ADDRESS - bootloaderSize);
+  }
+
+  // the total time of erasing the flash in write() and close() in microseconds.
+  // counted by the storages which erase a page or sector when the data reach it
+  unsigned long eraseTime() {
+    return eraseMicros;
+  }
+
 protected:
   const uint32_t SKETCH_START_ADDRESS;
   const uint32_t PAGE_SIZE;
   const uint32_t MAX_FLASH;
   uint32_t bootloaderSize;
+  unsigned long eraseMicros;
 
 };
 
@@ -40,6 +40,11 @@ public:
   virtual size_t write(uint8_t b) {
     return _file.write(b);
   }
+
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    return _file.write(buffer, size);
+  }
+
   virtual void close() {
     _file.close();
   }
@@ -48,6 +53,37 @@ public:
     SD.remove(updateFileName);
   }
 
+  virtual long suspend() {
+    long position = _file.position();
+    _file.close();
+    return position;
+  }
+
+  virtual int resume(int length, long offset) {
+    (void) length;
+    _file = SD.open(updateFileName, O_READ | O_WRITE);
+    if (!_file)
+      return 0;
+    if (!_file.seek(offset)) {
+      _file.close();
+      return 0;
+    }
+    return 1;
+  }
+
+  virtual bool canResume() {
+    return true;
+  }
+
+  virtual size_t read(long offset, uint8_t* buffer, size_t size) {
+    long position = _file.position();
+    if (!_file.seek(offset))
+      return 0;
+    int l = _file.read(buffer, size);
+    _file.seek(position);
+    return (l > 0) ? l : 0;
+  }
+
 private:
   File _file;
 };
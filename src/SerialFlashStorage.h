@@ -57,6 +57,11 @@ public:
     return ret;
   }
 
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    while (!SerialFlash.ready()) {}
+    return _file.write(buffer, size);
+  }
+
   virtual void close() {
     _file.close();
   }
@@ -65,6 +70,40 @@ public:
     SerialFlash.remove(updateFileName);
   }
 
+  virtual long suspend() {
+    long position = _file.position();
+    _file.close();
+    return position;
+  }
+
+  virtual int resume(int length, long offset) {
+    if (!SerialFlash.begin(SERIAL_FLASH_CS)) {
+      return 0;
+    }
+
+    while (!SerialFlash.ready()) {}
+
+    _file = SerialFlash.open(updateFileName);
+    if (!_file || _file.size() != (uint32_t) length) {
+      return 0;
+    }
+
+    _file.seek(offset);
+    return 1;
+  }
+
+  virtual bool canResume() {
+    return true;
+  }
+
+  virtual size_t read(long offset, uint8_t* buffer, size_t size) {
+    uint32_t position = _file.position();
+    _file.seek(offset);
+    size_t l = _file.read(buffer, size);
+    _file.seek(position);
+    return l;
+  }
+
 private:
   SerialFlashFile _file;
 };
@@ -26,7 +26,6 @@
 #include "WiFiOTA.h"
 
 #define BOARD "arduino"
-#define BOARD_LENGTH (sizeof(BOARD) - 1)
 
 static String base64Encode(const String& in)
 {
@@ -67,10 +66,26 @@ WiFiOTAClass::WiFiOTAClass() :
   _storage(NULL),
   localIp(0),
   _lastMdnsResponseTime(0),
+  _mdnsResponse(nullptr),
+  _mdnsResponseLength(0),
+  _mdnsResponsePending(false),
+  _mdnsAnnouncements(0),
+  _nonBlocking(false),
+  _state(OTA_IDLE),
+  _idleTimeout(10000),
+  _sessionTimeout(0),
+#if OTA_TASK
+  _ring(nullptr),
+  _writerTask(nullptr),
+#endif
+  _resumeImageId(0),
   beforeApplyCallback(nullptr),
   onErrorCallback(nullptr),
-  onStartCallback(nullptr)
+  onStartCallback(nullptr),
+  onProgressCallback(nullptr),
+  onSessionEndCallback(nullptr)
 {
+  memset(&_metrics, 0, sizeof(_metrics));
 }
 
 void WiFiOTAClass::begin(IPAddress& localIP, const char* name, const char* password, OTAStorage& storage)
@@ -79,59 +94,137 @@ void WiFiOTAClass::begin(IPAddress& localIP, const char* name, const char* passw
   _name = name;
   _expectedAuthorization = "Basic " + base64Encode("arduino:" + String(password));
   _storage = &storage;
+  buildMdnsResponse();
+  _mdnsAnnouncements = 2;
+  _mdnsResponseTime = millis();
 }
 
 void WiFiOTAClass::pollMdns(UDP &_mdnsSocket)
 {
+  if ((_mdnsResponsePending || _mdnsAnnouncements) && (long) (millis() - _mdnsResponseTime) >= 0) {
+    _mdnsResponsePending = false;
+    _lastMdnsResponseTime = millis();
+    sendMdnsResponse(_mdnsSocket, IPAddress(224, 0, 0, 251), 5353);
+    // the unsolicited announcements after begin() are sent one second apart (RFC 6762 8.3)
+    if (_mdnsAnnouncements && --_mdnsAnnouncements) {
+      _mdnsResponseTime = _lastMdnsResponseTime + 1000;
+    }
+  }
+
   int packetLength = _mdnsSocket.parsePacket();
 
-  if (packetLength <= 0) {
+  // the rest of an ignored packet is discarded by the next parsePacket()
+  if (packetLength < MDNS_HEADER_SIZE) {
     return;
   }
 
-  const byte ARDUINO_SERVICE_REQUEST[37] = {
-    0x00, 0x00, // transaction id
-    0x00, 0x00, // flags
-    0x00, 0x01, // questions
-    0x00, 0x00, // answer RRs
-    0x00, 0x00, // authority RRs
-    0x00, 0x00, // additional RRs
-    0x08,
-    0x5f, 0x61, 0x72, 0x64, 0x75, 0x69, 0x6e, 0x6f, // _arduino
-    0x04, 
-    0x5f, 0x74, 0x63, 0x70, // _tcp
-    0x05,
-    0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, // local
-    0x00, 0x0c, // PTR
-    0x00, 0x01 // Class IN
-  };
+  byte header[MDNS_HEADER_SIZE];
+  if (_mdnsSocket.read(header, MDNS_HEADER_SIZE) != MDNS_HEADER_SIZE || !MdnsQuery::isQuery(header)) {
+    return;
+  }
 
-  if (packetLength != sizeof(ARDUINO_SERVICE_REQUEST)) {
-    while (packetLength) {
-      if (_mdnsSocket.available()) {
-        packetLength--;
-        _mdnsSocket.read();
-      }
-    }
+  MdnsQuery query;
+  if (!query.parse(header, _mdnsSocket, packetLength, _name.c_str()) || !(query.service || query.host)) {
+    return;
+  }
+  if (query.knownAnswer && !query.host) {
+    _metrics.mdnsSuppressed++;
     return;
   }
 
-  byte request[packetLength];
+  uint16_t port = _mdnsSocket.remotePort();
+  if (query.unicast || port != 5353) {
+    // a legacy resolver (not from port 5353) gets the id of the query
+    sendMdnsResponse(_mdnsSocket, _mdnsSocket.remoteIP(), port, (port != 5353) ? header : nullptr);
+    return;
+  }
 
-  _mdnsSocket.read(request, sizeof(request));
+  if (_mdnsResponsePending || _mdnsAnnouncements) { // answered together with the previous queries
+    _metrics.mdnsSuppressed++;
+    return;
+  }
+  // shared records are answered after a random delay of 20 to 120 ms or
+  // 400 to 500 ms if more known answers follow (RFC 6762 6 and 7.2).
+  // the response is multicast at most once per second
+  _mdnsResponsePending = true;
+  _mdnsResponseTime = millis() + (query.truncated ? random(400, 501) : random(20, 121));
+  if ((long) (_mdnsResponseTime - _lastMdnsResponseTime) < 1000) {
+    _mdnsResponseTime = _lastMdnsResponseTime + 1000;
+  }
+}
 
-  if (memcmp(&request[2], &ARDUINO_SERVICE_REQUEST[2], packetLength - 2) != 0) {
+void WiFiOTAClass::sendMdnsResponse(UDP &_mdnsSocket, IPAddress ip, uint16_t port, const byte* id)
+{
+  if (!_mdnsResponse) {
     return;
   }
+  _metrics.mdnsResponses++;
+  _mdnsSocket.beginPacket(ip, port);
+  if (id) {
+    _mdnsSocket.write(id, 2);
+    _mdnsSocket.write(_mdnsResponse + 2, _mdnsResponseLength - 2);
+  } else {
+    _mdnsSocket.write(_mdnsResponse, _mdnsResponseLength);
+  }
+  _mdnsSocket.endPacket();
+}
 
-  if ((millis() - _lastMdnsResponseTime) < 1000) {
-    // ignore request
+// the PTR record with TTL 0 removes the service from the caches of the browsers (RFC 6762 10.1)
+void WiFiOTAClass::sendMdnsGoodbye(UDP &_mdnsSocket)
+{
+  _mdnsAnnouncements = 0;
+  _mdnsResponsePending = false;
+  if (!_mdnsResponse) {
     return;
   }
-  _lastMdnsResponseTime = millis();
+  const size_t PTR_TTL_OFFSET = 37; // header, service name, type and class
+  const size_t PTR_RECORD_END = PTR_TTL_OFFSET + 7 + _name.length() + 2; // TTL, length, name and pointer
+
+  byte header[MDNS_HEADER_SIZE];
+  memcpy(header, _mdnsResponse, sizeof(header));
+  header[7] = 1; // only the PTR answer
+  const byte ttl[4] = {0};
 
   _mdnsSocket.beginPacket(IPAddress(224, 0, 0, 251), 5353);
+  _mdnsSocket.write(header, sizeof(header));
+  _mdnsSocket.write(_mdnsResponse + MDNS_HEADER_SIZE, PTR_TTL_OFFSET - MDNS_HEADER_SIZE);
+  _mdnsSocket.write(ttl, sizeof(ttl));
+  _mdnsSocket.write(_mdnsResponse + PTR_TTL_OFFSET + 4, PTR_RECORD_END - PTR_TTL_OFFSET - 4);
+  _mdnsSocket.endPacket();
+}
+
+// a TXT string is prefixed with its length
+static void addTxt(String& txt, const char* key, const char* value)
+{
+  size_t length = strlen(key) + 1 + strlen(value);
+  if (length > 255)
+    return;
+  txt += (char) length;
+  txt += key;
+  txt += '=';
+  txt += value;
+}
+
+void WiFiOTAClass::addMdnsTxt(const char* key, const char* value)
+{
+  addTxt(_mdnsTxt, key, value);
+  if (_storage) { // after begin()
+    buildMdnsResponse();
+    _mdnsAnnouncements = 2;
+    _mdnsResponseTime = millis();
+  }
+}
+
+static uint8_t* append(uint8_t* p, const void* data, size_t length)
+{
+  memcpy(p, data, length);
+  return p + length;
+}
 
+// the response depends only on the name and the IP address,
+// so it is serialized once in begin() and sent with one write
+void WiFiOTAClass::buildMdnsResponse()
+{
   const byte responseHeader[] = {
     0x00, 0x00, // transaction id
     0x84, 0x00, // flags
@@ -140,7 +233,6 @@ void WiFiOTAClass::pollMdns(UDP &_mdnsSocket)
     0x00, 0x00, // authority RRs
     0x00, 0x00  // additional RRS
   };
-  _mdnsSocket.write(responseHeader, sizeof(responseHeader));
 
   const byte ptrRecordStart[] = {
     0x08,
@@ -165,27 +257,40 @@ void WiFiOTAClass::pollMdns(UDP &_mdnsSocket)
     0xc0, 0x0c
   };
 
-  _mdnsSocket.write(ptrRecordStart, sizeof(ptrRecordStart));
-  _mdnsSocket.write((const byte*) _name.c_str(), _name.length());
-  _mdnsSocket.write(ptrRecordEnd, sizeof(ptrRecordEnd));
+  // the TXT strings after the fixed ones
+  String txt;
+  addTxt(txt, "board", BOARD);
+  addTxt(txt, "max_size", String(_storage->maxSize()).c_str());
+  String features = "heatshrink"; // the decoding and the checksums are in the server
+  if (_storage->canResume()) {
+    features += ",resume";
+  }
+  features += ",crc32";
+#if OTA_SHA256
+  features += ",sha256";
+#endif
+  if (_storage->sketchImage()) {
+    features += ",delta";
+#if OTA_MAX_PAGES > 8
+    features += ",pages";
+#endif
+  }
+  addTxt(txt, "ota_features", features.c_str());
+  txt += _mdnsTxt;
 
   const byte txtRecord[] = {
     0xc0, 0x2b,
     0x00, 0x10, // TXT strings
     0x80, 0x01, // class
     0x00, 0x00, 0x11, 0x94, // TTL
-    0x00, (50 + BOARD_LENGTH),
+    (byte)((43 + txt.length()) >> 8), (byte)(43 + txt.length()),
     13,
     's', 's', 'h', '_', 'u', 'p', 'l', 'o', 'a', 'd', '=', 'n', 'o',
     12,
     't', 'c', 'p', '_', 'c', 'h', 'e', 'c', 'k', '=', 'n', 'o',
     15,
-    'a', 'u', 't', 'h', '_', 'u', 'p', 'l', 'o', 'a', 'd', '=', 'y', 'e', 's',
-    (6 + BOARD_LENGTH),
-    'b', 'o', 'a', 'r', 'd', '=',
+    'a', 'u', 't', 'h', '_', 'u', 'p', 'l', 'o', 'a', 'd', '=', 'y', 'e', 's'
   };
-  _mdnsSocket.write(txtRecord, sizeof(txtRecord));
-  _mdnsSocket.write((byte*)BOARD, BOARD_LENGTH);
 
   const byte srvRecordStart[] = {
     0xc0, 0x2b, 
@@ -203,17 +308,13 @@ void WiFiOTAClass::pollMdns(UDP &_mdnsSocket)
     0xc0, 0x1a
   };
 
-  _mdnsSocket.write(srvRecordStart, sizeof(srvRecordStart));
-  _mdnsSocket.write((const byte*) _name.c_str(), _name.length());
-  _mdnsSocket.write(srvRecordEnd, sizeof(srvRecordEnd));
-
-  byte aRecordNameOffset = sizeof(responseHeader) +
+  size_t aRecordNameOffset = sizeof(responseHeader) +
                             sizeof(ptrRecordStart) + _name.length() + sizeof(ptrRecordEnd) + 
-                            sizeof(txtRecord) + BOARD_LENGTH +
+                            sizeof(txtRecord) + txt.length() +
                             sizeof(srvRecordStart) - 1;
 
   byte aRecord[] = {
-    0xc0, aRecordNameOffset,
+    (byte)(0xc0 | (aRecordNameOffset >> 8)), (byte) aRecordNameOffset,
 
     0x00, 0x01, // A record
     0x80, 0x01, // class
@@ -222,153 +323,1119 @@ void WiFiOTAClass::pollMdns(UDP &_mdnsSocket)
     0xff, 0xff, 0xff, 0xff // IP
   };
   memcpy(&aRecord[sizeof(aRecord) - 4], &localIp, sizeof(localIp));
-  _mdnsSocket.write(aRecord, sizeof(aRecord));
 
-  _mdnsSocket.endPacket();
+  size_t length = aRecordNameOffset + 1 + _name.length() + sizeof(srvRecordEnd) + sizeof(aRecord);
+  if (length != _mdnsResponseLength) {
+    free(_mdnsResponse);
+    _mdnsResponse = (byte*) malloc(length);
+  }
+  if (!_mdnsResponse) {
+    _mdnsResponseLength = 0;
+    return;
+  }
+  _mdnsResponseLength = length;
+
+  byte* p = _mdnsResponse;
+  p = append(p, responseHeader, sizeof(responseHeader));
+  p = append(p, ptrRecordStart, sizeof(ptrRecordStart));
+  p = append(p, _name.c_str(), _name.length());
+  p = append(p, ptrRecordEnd, sizeof(ptrRecordEnd));
+  p = append(p, txtRecord, sizeof(txtRecord));
+  p = append(p, txt.c_str(), txt.length());
+  p = append(p, srvRecordStart, sizeof(srvRecordStart));
+  p = append(p, _name.c_str(), _name.length());
+  p = append(p, srvRecordEnd, sizeof(srvRecordEnd));
+  append(p, aRecord, sizeof(aRecord));
 }
 
 void WiFiOTAClass::pollServer(Client& client)
 {
+  if (_state == OTA_IDLE) {
+    if (!client)
+      return;
 
-  if (client) {
-	
     if (onStartCallback) {
       onStartCallback();
     }
-	  
-    String request = client.readStringUntil('\n');
-    request.trim();
 
-    String header;
-    long contentLength = -1;
-    String authorization;
+    _state = OTA_HEADERS;
+    _parserState = PARSE_METHOD;
+    _method = METHOD_OTHER;
+    _path[0] = 0;
+    _tokenLength = 0;
+    _headerSize = 0;
+    _authorized = false;
+    _expectContinue = false;
+    _chunked = false;
+    _contentLength = -1;
+    _rangeStart = -1;
+    _imageId = 0;
+    _encoding = 0;
+    _decodedLength = -1;
+    _pageSize = -1;
+    _digests = 0;
+    _read = 0;
+    _responseCode = 0;
+    _lastDataTime = millis();
+    _sessionStart = _lastDataTime;
+    memset(&_times, 0, sizeof(_times));
+    _phaseStart = micros();
+    _scrape = false;
+    _applyUpdate = false;
+    OTA_TRACE_EVENT(TRACE_ACCEPT, 0);
+  }
+
+  // in non-blocking mode only one step of the session is done in one poll
+  do {
+    switch (_state) {
+      case OTA_HEADERS:
+        readHeaders(client);
+        break;
+      case OTA_BODY:
+        readBody(client);
+        break;
+      case OTA_PAGE_HASHES:
+        readPageHashes(client);
+        break;
+      case OTA_DISCARD:
+        discardBody(client);
+        break;
+      case OTA_CLOSING:
+        waitClose(client);
+        break;
+    }
+    if (_state == OTA_IDLE) {
+      if (_applyUpdate) {
+        applyUpdate();
+      }
+      endSession();
+    }
+  } while (_state != OTA_IDLE && !_nonBlocking);
+}
 
-    do {
-      header = client.readStringUntil('\n');
-      header.trim();
+void WiFiOTAClass::readHeaders(Client& client)
+{
+  while (client.available()) {
+    int c = client.read();
+    if (c < 0)
+      break;
+    _lastDataTime = millis();
+    if (++_headerSize > OTA_MAX_HEADER_SIZE) {
+      sendHttpResponse(client, 431, "Request Header Fields Too Large");
+      return;
+    }
+    if (parseRequest(c)) {
+      handleRequest(client);
+      return;
+    }
+    if (_nonBlocking && c == '\n')
+      return; // a header line per poll
+  }
 
-      if (header.startsWith("Content-Length: ")) {
-        header.remove(0, 16);
+  if (!client.connected()) {
+    client.stop();
+    _state = OTA_IDLE;
+  } else if (millis() - _lastDataTime > _idleTimeout || sessionTimedOut()) {
+    if (_headerSize > 0) { // a stalled request, not an idle connection
+      sendHttpResponse(client, 408, "Request Timeout");
+    } else {
+      client.stop();
+      _state = OTA_IDLE;
+    }
+  }
+}
 
-        contentLength = header.toInt();
-      } else if (header.startsWith("Authorization: ")) {
-        header.remove(0, 15);
-        authorization = header;
+bool WiFiOTAClass::sessionTimedOut()
+{
+  return _sessionTimeout && millis() - _sessionStart > _sessionTimeout;
+}
+
+bool WiFiOTAClass::timedOut()
+{
+  unsigned long timeout = _idleTimeout;
+  if (_read > 0) { // a slow upload which progresses gets more time for a pause
+    timeout += min((_lastDataTime - _bodyStart) / ((_read + 2047) / 2048), 3 * _idleTimeout);
+  }
+  return millis() - _lastDataTime > timeout || sessionTimedOut();
+}
+
+static const char* const HEADER_NAMES[] = {
+  "content-length",
+  "authorization",
+  "expect",
+  "transfer-encoding",
+  "content-range",
+  "x-ota-image",
+  "content-encoding",
+  "x-ota-length",
+  "x-ota-page-size",
+  "x-ota-crc32",
+  "x-ota-sha256"
+};
+
+// returns true after the empty line which ends the headers
+bool WiFiOTAClass::parseRequest(char c)
+{
+  if (c == '\r')
+    return false;
+
+  switch (_parserState) {
+    case PARSE_METHOD:
+      if (c == ' ') {
+        _method = tokenIs("post") ? METHOD_POST : (tokenIs("get") ? METHOD_GET : (tokenIs("head") ? METHOD_HEAD : METHOD_OTHER));
+        _pathLength = 0;
+        _parserState = PARSE_PATH;
+      } else if (c == '\n') {
+        if (_tokenLength) { // a request line without path
+          _parserState = PARSE_NAME;
+        }
+      } else {
+        appendToken(c);
+        return false;
+      }
+      _tokenLength = 0;
+      break;
+    case PARSE_PATH:
+      if (c == ' ' || c == '\n') {
+        _path[_pathLength < sizeof(_path) ? _pathLength : 0] = 0; // too long path is not found
+        _parserState = (c == ' ') ? PARSE_VERSION : PARSE_NAME;
+      } else if (_pathLength < sizeof(_path)) {
+        _path[_pathLength++] = c;
       }
-    } while (header != "");
+      break;
+    case PARSE_VERSION: // the version is not checked
+      if (c == '\n') {
+        _parserState = PARSE_NAME;
+      }
+      break;
+    case PARSE_NAME:
+      if (c == ':') {
+        _header = HEADER_OTHER;
+        for (uint8_t i = 0; i < sizeof(HEADER_NAMES) / sizeof(HEADER_NAMES[0]); i++) {
+          if (tokenIs(HEADER_NAMES[i])) {
+            _header = i;
+            break;
+          }
+        }
+        _tokenLength = 0;
+        _pendingSpaces = 0;
+        _valueIndex = 0;
+        _authMatch = true;
+        _parserState = PARSE_VALUE;
+      } else if (c == '\n') {
+        if (_tokenLength == 0)
+          return true; // empty line
+        _tokenLength = 0; // ignore a line without colon
+      } else {
+        appendToken(c);
+      }
+      break;
+    case PARSE_VALUE:
+      if (c == '\n') {
+        endHeaderValue();
+        _tokenLength = 0;
+        _parserState = PARSE_NAME;
+      } else if (c == ' ' || c == '\t') {
+        if (_tokenLength || _valueIndex) { // leading and trailing spaces are skipped
+          _pendingSpaces++;
+        }
+      } else {
+        for (; _pendingSpaces; _pendingSpaces--) {
+          appendHeaderValue(' ');
+        }
+        appendHeaderValue(c);
+      }
+      break;
+  }
+  return false;
+}
 
-    bool dataUpload = false;
-#if defined(ESP8266) || defined(ESP32)
-    if (request == "POST /data HTTP/1.1") {
-      dataUpload = true;
-    } else
+void WiFiOTAClass::appendToken(char c)
+{
+  if (_tokenLength < sizeof(_token) - 1) {
+    _token[_tokenLength++] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  } else {
+    _tokenLength = sizeof(_token); // overflow. matches nothing
+  }
+}
+
+bool WiFiOTAClass::tokenIs(const char* s)
+{
+  return _tokenLength < sizeof(_token) && strlen(s) == _tokenLength && !memcmp(_token, s, _tokenLength);
+}
+
+static int8_t hexDigit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+void WiFiOTAClass::appendHeaderValue(char c)
+{
+  if (_header == HEADER_IMAGE) { // FNV-1a hash of the image identifier
+    _imageId = ((_imageId ? _imageId : 2166136261UL) ^ (uint8_t) c) * 16777619UL;
+    return;
+  }
+  if (_header == HEADER_SHA256) { // too long for _token
+#if OTA_SHA256
+    int8_t d = hexDigit(c);
+    if (d < 0 || _valueIndex >= 64) {
+      _digests |= DIGEST_INVALID;
+    } else if (_valueIndex % 2) {
+      _expectedSha256[_valueIndex / 2] |= d;
+    } else {
+      _expectedSha256[_valueIndex / 2] = d << 4;
+    }
 #endif
-    if (request != "POST /sketch HTTP/1.1") {
-      flushRequestBody(client, contentLength);
-      sendHttpResponse(client, 404, "Not Found");
-      return;
+    if (_valueIndex < OTA_MAX_HEADER_SIZE) {
+      _valueIndex++;
     }
+    return;
+  }
+  if (_header != HEADER_AUTHORIZATION) {
+    appendToken(c);
+    return;
+  }
+  // compared with the expected value without storing the value
+  if (_valueIndex >= _expectedAuthorization.length() || _expectedAuthorization.charAt(_valueIndex) != c) {
+    _authMatch = false;
+  }
+  if (_valueIndex < OTA_MAX_HEADER_SIZE) {
+    _valueIndex++;
+  }
+}
 
-    if (_expectedAuthorization != authorization) {
-      flushRequestBody(client, contentLength);
-      sendHttpResponse(client, 401, "Unauthorized");
-      return;
+void WiFiOTAClass::endHeaderValue()
+{
+  if (_tokenLength < sizeof(_token)) {
+    _token[_tokenLength] = 0;
+  }
+  switch (_header) {
+    case HEADER_CONTENT_LENGTH: {
+      const char* p = _token;
+      _contentLength = parseNumber(p);
+      if (*p) {
+        _contentLength = -1;
+      }
+      break;
+    }
+    case HEADER_DECODED_LENGTH: {
+      const char* p = _token;
+      _decodedLength = parseNumber(p);
+      if (*p) {
+        _decodedLength = -1;
+      }
+      break;
+    }
+    case HEADER_PAGE_SIZE: {
+      const char* p = _token;
+      _pageSize = parseNumber(p);
+      if (*p || _pageSize > 0xFFFF) {
+        _pageSize = -1;
+      }
+      break;
+    }
+    case HEADER_CONTENT_ENCODING:
+      if (_tokenLength >= sizeof(_token)) {
+        _encoding = ENCODING_UNKNOWN;
+        break;
+      }
+      for (char* p = strtok(_token, ", "); p; p = strtok(nullptr, ", ")) {
+        if (!strcmp(p, "heatshrink")) {
+          _encoding |= ENCODING_HEATSHRINK;
+        } else if (!strcmp(p, "x-ota-delta")) {
+          _encoding |= ENCODING_DELTA;
+        } else if (!strcmp(p, "x-ota-pages")) {
+          _encoding |= ENCODING_PAGES;
+        } else if (strcmp(p, "identity")) {
+          _encoding |= ENCODING_UNKNOWN;
+        }
+      }
+      break;
+    case HEADER_CRC32: {
+      _expectedCrc32 = 0;
+      int8_t d = -1;
+      for (uint8_t i = 0; i < _tokenLength && (d = hexDigit(_token[i])) >= 0; i++) {
+        _expectedCrc32 = (_expectedCrc32 << 4) | d;
+      }
+      _digests |= (d < 0 || _tokenLength > 8) ? DIGEST_INVALID : DIGEST_CRC32;
+      break;
     }
+    case HEADER_SHA256:
+      _digests |= (_valueIndex == 64) ? DIGEST_SHA256 : DIGEST_INVALID;
+      break;
+    case HEADER_AUTHORIZATION:
+      _authorized = _authMatch && _valueIndex == _expectedAuthorization.length();
+      break;
+    case HEADER_EXPECT:
+      _expectContinue = tokenIs("100-continue");
+      break;
+    case HEADER_TRANSFER_ENCODING:
+      _chunked = !tokenIs("identity");
+      break;
+    case HEADER_CONTENT_RANGE: { // bytes <start>-<end>/<length>
+      const char* p = _token;
+      _rangeStart = 0; // a present header is invalid until parsed
+      _rangeLength = -1;
+      if (_tokenLength < sizeof(_token) && !strncmp(p, "bytes ", 6)) {
+        p += 6;
+        long start = parseNumber(p);
+        long end = (*p == '-') ? parseNumber(++p) : -1;
+        long length = (*p == '/') ? parseNumber(++p) : -1;
+        // the range ends with the binary. parseNumber caps too long numbers at 0x7FFFFFFF
+        if (!*p && start >= 0 && end >= start && end == length - 1 && length < 0x7FFFFFFF) {
+          _rangeStart = start;
+          _rangeEnd = end;
+          _rangeLength = length;
+        }
+      }
+      break;
+    }
+  }
+}
+
+// parses a decimal number at p and moves p after it. returns -1 if there are no digits
+long WiFiOTAClass::parseNumber(const char*& p)
+{
+  if (_tokenLength >= sizeof(_token) || *p < '0' || *p > '9')
+    return -1;
+  long n = 0;
+  for (uint8_t i = 0; *p >= '0' && *p <= '9'; i++, p++) {
+    if (i >= 9) {
+      n = 0x7FFFFFFF; // too large for any storage
+    } else {
+      n = n * 10 + (*p - '0');
+    }
+  }
+  return n;
+}
+
+void WiFiOTAClass::handleRequest(Client& client)
+{
+  _times.headers = micros() - _phaseStart;
+  OTA_TRACE_EVENT(TRACE_HEADERS, _contentLength);
 
-    if (contentLength <= 0) {
-      sendHttpResponse(client, 400, "Bad Request");
+  if (_method == METHOD_GET && strcmp(_path, "/metrics") == 0) {
+    if (!_authorized) {
+      rejectUpload(client, 401, "Unauthorized");
       return;
     }
+    sendText(client, "text/plain; version=0.0.4", &WiFiOTAClass::printMetrics);
+    _scrape = true;
+    return;
+  }
+#if OTA_TRACE
+  if (_method == METHOD_GET && strcmp(_path, "/trace") == 0) {
+    if (!_authorized) {
+      rejectUpload(client, 401, "Unauthorized");
+      return;
+    }
+    sendText(client, "text/plain", &WiFiOTAClass::printTrace);
+    _scrape = true;
+    return;
+  }
+#endif
+
+  bool sketchPath = (strcmp(_path, "/sketch") == 0);
+  bool pagesPath = (_method == METHOD_POST && strcmp(_path, "/sketch/pages") == 0);
+  _dataUpload = false;
+#if defined(ESP8266) || defined(ESP32)
+  if (_method == METHOD_POST && strcmp(_path, "/data") == 0) {
+    _dataUpload = true;
+  } else
+#endif
+  if (!pagesPath && (!sketchPath || (_method != METHOD_POST && _method != METHOD_HEAD))) {
+    rejectUpload(client, 404, "Not Found");
+    return;
+  }
+
+  if (!_authorized) {
+    rejectUpload(client, 401, "Unauthorized");
+    return;
+  }
+
+  if (_method == METHOD_HEAD) { // query of the resumable upload's offset
+    char header[32];
+    snprintf(header, sizeof(header), "X-OTA-Offset: %ld\r\n", (_imageId && _imageId == _resumeImageId) ? _resumeOffset : 0L);
+    sendHttpResponse(client, 200, "OK", header);
+    return;
+  }
+
+  if (_chunked) {
+    _contentLength = -1; // the body can't be skipped
+    rejectUpload(client, 411, "Length Required");
+    return;
+  }
+
+  if (_contentLength <= 0 || (_digests & DIGEST_INVALID)) {
+    rejectUpload(client, 400, "Bad Request");
+    return;
+  }
 
-    if (_storage == NULL || !_storage->open(contentLength, dataUpload)) {
-      flushRequestBody(client, contentLength);
-      sendHttpResponse(client, 500, "Internal Server Error");
+#if !OTA_SHA256
+  if (_digests & DIGEST_SHA256) {
+    rejectUpload(client, 501, "Not Implemented");
+    return;
+  }
+#endif
+
+  if (pagesPath) {
+    handlePageHashes(client);
+    return;
+  }
+
+  if ((_encoding & ENCODING_UNKNOWN) || ((_encoding & ENCODING_DELTA) && (_encoding & ENCODING_PAGES))
+      || ((_encoding & (ENCODING_DELTA | ENCODING_PAGES)) && (_storage == NULL || !_storage->sketchImage()))) {
+    rejectUpload(client, 415, "Unsupported Media Type");
+    return;
+  }
+
+#if OTA_SHA256
+  // a changed page with the CRC-32 of the page of the running sketch would be
+  // kept unchanged, so the whole binary is verified
+  if ((_encoding & ENCODING_PAGES) && !(_digests & DIGEST_SHA256)) {
+    rejectUpload(client, 400, "Bad Request");
+    return;
+  }
+#endif
+
+  // the length of the binary, which is stored. Content-Length is the length of the encoded body
+  _uploadLength = _contentLength;
+  if (_encoding) {
+    if (_decodedLength <= 0) {
+      rejectUpload(client, 400, "Bad Request");
+      return;
+    }
+    _uploadLength = _decodedLength;
+  }
+  if (_rangeStart >= 0) {
+    if (_rangeLength < 0 || _rangeEnd - _rangeStart + 1 != _uploadLength) {
+      rejectUpload(client, 400, "Bad Request");
       return;
     }
+    _uploadLength = _rangeLength;
+  }
 
-    if (_storage->maxSize() && contentLength > _storage->maxSize()) {
-      _storage->close();
-      flushRequestBody(client, contentLength);
-      sendHttpResponse(client, 413, "Payload Too Large");
+  // checked before open(), which erases the flash in some storages
+  if (_storage != NULL && _storage->maxSize() && _uploadLength > _storage->maxSize()) {
+    rejectUpload(client, 413, "Payload Too Large");
+    return;
+  }
+
+  // the changed pages must be of the binary compared with the last page hashes request
+  if ((_encoding & ENCODING_PAGES) && !_pageDecoder.begin(_uploadLength, _rangeStart > 0 ? _rangeStart : 0)) {
+    rejectUpload(client, 409, "Conflict");
+    return;
+  }
+
+  if (_rangeStart > 0) {
+    if (!_imageId || _imageId != _resumeImageId || _uploadLength != _resumeLength
+        || _rangeStart != _resumeOffset) {
+      rejectUpload(client, 416, "Range Not Satisfiable");
       return;
     }
+  } else {
+    _rangeStart = 0;
+  }
+  _resumeImageId = 0;
+
+  unsigned long t = micros();
+  bool opened = (_storage != NULL) && (_rangeStart > 0 ? _storage->resume(_uploadLength, _rangeStart) : _storage->open(_uploadLength, _dataUpload));
+  if (!opened) {
+    _times.open = micros() - t;
+    rejectUpload(client, 500, "Internal Server Error");
+    return;
+  }
+
+  _crc32 = 0;
+#if OTA_SHA256
+  if (_digests & DIGEST_SHA256) {
+    sha256Begin(_sha256);
+  }
+#endif
+  // the digests are of the whole binary, so the stored part of a resumed upload is read back
+  if (_rangeStart > 0 && (_digests & (DIGEST_CRC32 | DIGEST_SHA256)) && !hashStoredPart()) {
+    _storage->close();
+    _storage->clear();
+    _times.open = micros() - t;
+    rejectUpload(client, 501, "Not Implemented");
+    return;
+  }
+  _times.open = micros() - t;
 
-    long read = 0;
+  if ((_encoding & ENCODING_HEATSHRINK) && !_decoder.begin()) {
+    _storage->close();
+    rejectUpload(client, 500, "Internal Server Error");
+    return;
+  }
+  if (_encoding & ENCODING_DELTA) {
+    _deltaDecoder.begin(_storage->sketchImage(), _storage->sketchImageSize());
+  }
+
+  if (_expectContinue) {
+    client.print("HTTP/1.1 100 Continue\r\n\r\n");
+  }
+
+  _imageOffset = _rangeStart;
+  _state = OTA_BODY;
+  _phaseStart = micros();
+  _eraseStart = _storage->eraseTime();
+  _lastDataTime = millis(); // the open() could erase the flash for a long time
+  _bodyStart = _lastDataTime;
+}
+
+void WiFiOTAClass::handlePageHashes(Client& client)
+{
+  if (_storage == NULL || !_storage->sketchImage()) {
+    rejectUpload(client, 501, "Not Implemented");
+    return;
+  }
+
+  // the page size is a power of two, so the pages don't cross the flash pages or sectors
+  if (_decodedLength <= 0 || _pageSize < 64 || (_pageSize & (_pageSize - 1))) {
+    rejectUpload(client, 400, "Bad Request");
+    return;
+  }
+
+  // checked before the previous comparison is discarded
+  long pages = (_decodedLength - 1) / _pageSize + 1;
+  if ((_storage->maxSize() && _decodedLength > _storage->maxSize()) || pages > OTA_MAX_PAGES) {
+    rejectUpload(client, 413, "Payload Too Large");
+    return;
+  }
+
+  if (_contentLength != pages * 4) {
+    rejectUpload(client, 400, "Bad Request");
+    return;
+  }
+
+  _pageDecoder.beginCompare(_storage->sketchImage(), _storage->sketchImageSize(), _decodedLength, _pageSize);
+
+  if (_expectContinue) {
+    client.print("HTTP/1.1 100 Continue\r\n\r\n");
+  }
+
+  _state = OTA_PAGE_HASHES;
+  _bodyStart = millis();
+}
+
+void WiFiOTAClass::readPageHashes(Client& client)
+{
+  if (client.available()) {
     byte buff[64];
+    int l = client.read(buff, min((long) sizeof(buff), _contentLength - _read));
+    if (l > 0) {
+      _pageDecoder.compare(buff, l);
+      _read += l;
+      _lastDataTime = millis();
+    }
+    if (_read < _contentLength && !timedOut())
+      return;
+  } else if (client.connected() && !timedOut()) {
+    return;
+  }
 
-    while (client.connected() && read < contentLength) {
-      while (client.available()) {
-        int l = client.read(buff, sizeof(buff));
-        if (l > 0) { // some libraries return -1 if no data are available
-          for (int i = 0; i < l; i++) {
-            _storage->write(buff[i]);
-          }
-          read += l;
-        }
+  _state = OTA_IDLE;
+
+  if (_read < _contentLength) {
+    if (client.connected()) {
+      sendHttpResponse(client, 408, "Request Timeout");
+    } else {
+      client.stop();
+    }
+    return;
+  }
+
+  char header[sizeof("X-OTA-Pages: \r\n") + OTA_MAX_PAGES / 4];
+  strcpy(header, "X-OTA-Pages: ");
+  _pageDecoder.printBitmap(header + strlen(header), sizeof(header) - strlen(header) - 2);
+  strcat(header, "\r\n");
+  sendHttpResponse(client, 200, "OK", header);
+}
+
+void WiFiOTAClass::readBody(Client& client)
+{
+  if (client.available()) {
+#if OTA_TASK
+    int l = _ring ? receiveBodyToRing(client) : receiveBody(client);
+#else
+    int l = receiveBody(client);
+#endif
+    if (l > 0) {
+      _read += l;
+      _lastDataTime = millis();
+      _metrics.receivedBytes += l;
+      if (onProgressCallback) {
+        onProgressCallback(_read, _contentLength);
       }
     }
+    if (_read < _contentLength && !timedOut())
+      return;
+  } else if (client.connected() && !timedOut()) {
+    return;
+  }
+
+#if OTA_TASK
+  while (_ring && !_ring->empty()) { // the writer task writes the rest
+    delay(1);
+  }
+#endif
+  _state = OTA_IDLE;
+  _times.body = micros() - _phaseStart;
+  uint32_t ms = _times.body / 1000;
+  _metrics.receiveTime += ms;
+  if (ms > _metrics.maxReceiveTime) {
+    _metrics.maxReceiveTime = ms;
+  }
+  _metrics.openTime += _times.open / 1000;
+  _metrics.writeTime += _times.write / 1000;
+  _metrics.lastThroughput = ms ? (uint32_t) (_read * 1000.0 / ms) : 0;
+  unsigned long t = micros();
 
+  if (_read == _contentLength && _imageOffset == _uploadLength) {
     _storage->close();
+    _times.close = micros() - t;
+    countEraseTime();
+    if (!checkDigests()) {
+      _storage->clear();
+      sendHttpResponse(client, 422, "Checksum mismatch");
+      return;
+    }
+    sendHttpResponse(client, 200, "OK");
+    _applyUpdate = true; // after the client closed the connection
+  } else {
+
+    if (_imageId) { // keep the received part for a resumed upload
+      _resumeOffset = _storage->suspend();
+      _resumeLength = _uploadLength;
+      _resumeImageId = _imageId;
+    } else {
+      _storage->close();
+      _storage->clear();
+    }
+    _times.close = micros() - t;
+    countEraseTime();
+    if ((_encoding & ENCODING_DELTA) && _deltaDecoder.failed()) {
+      sendHttpResponse(client, 409, "Conflict"); // the patch is not for the running sketch
+    } else if (_read < _contentLength && client.connected()) {
+      sendHttpResponse(client, 408, "Request Timeout");
+    } else {
+      sendHttpResponse(client, 414, "Payload size wrong");
+    }
+  }
+}
 
-    if (read == contentLength) {
-      sendHttpResponse(client, 200, "OK");
+// the storages erase in write() and in close() for the last part of the binary
+void WiFiOTAClass::countEraseTime()
+{
+  _times.erase = _storage->eraseTime() - _eraseStart;
+  _metrics.eraseTime += _times.erase / 1000;
+}
 
-      delay(500);
+// reads the available data of the body and writes them. returns the count of read bytes
+int WiFiOTAClass::receiveBody(Client& client)
+{
+  byte buff[64];
+  // some libraries return only a few bytes from a read, so the buffer
+  // is filled with the available data before it is decoded and written.
+  // a poll() in the non-blocking mode does only a few reads
+  int size = min((long) sizeof(buff), _contentLength - _read);
+  int maxReads = _nonBlocking ? OTA_RECEIVE_READS_NON_BLOCKING : OTA_RECEIVE_READS;
+  int l = 0;
+  int reads = 0;
+  do {
+    int n = client.read(buff + l, size - l);
+    OTA_TRACE_EVENT(TRACE_READ, n);
+    if (n <= 0) // some libraries return -1 if no data are available
+      break;
+    l += n;
+  } while (l < size && ++reads < maxReads && client.available());
+  if (l > 0) {
+    writeBody(buff, l);
+  }
+  return l;
+}
 
-      if (beforeApplyCallback) {
-        beforeApplyCallback();
-      }
+#if OTA_TASK
+// reads the available data into the ring buffer for the writer task
+int WiFiOTAClass::receiveBodyToRing(Client& client)
+{
+  uint8_t* p;
+  long size = min((long) _ring->writable(p), _contentLength - _read);
+  if (size == 0) { // the ring buffer is full until the writer task writes.
+    _lastDataTime = millis(); // a long erase of the flash is not an idle client
+    return 0;
+  }
+  int l = client.read(p, size);
+  OTA_TRACE_EVENT(TRACE_READ, l);
+  if (l > 0) {
+    _ring->commit(l);
+    xTaskNotifyGive(_writerTask);
+  }
+  return l;
+}
 
-      // apply the update
-      _storage->apply();
-      
-      while (true);
-    } else {
+void WiFiOTAClass::writerTask(void* ota)
+{
+  OTARingBuffer* ring = ((WiFiOTAClass*) ota)->_ring;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    const uint8_t* p;
+    size_t l;
+    while ((l = ring->readable(p)) > 0) {
+      ((WiFiOTAClass*) ota)->writeBody(p, l);
+      ring->consume(l);
+    }
+  }
+}
 
-      sendHttpResponse(client, 414, "Payload size wrong");
-      _storage->clear();
+static bool createTask(TaskFunction_t fn, const char* name, void* arg, UBaseType_t priority, int core, TaskHandle_t* handle)
+{
+#ifdef ESP32
+  return xTaskCreatePinnedToCore(fn, name, OTA_TASK_STACK_SIZE, arg, priority, handle, core) == pdPASS;
+#else
+  if (xTaskCreate(fn, name, OTA_TASK_STACK_SIZE / sizeof(StackType_t), arg, priority, handle) != pdPASS)
+    return false;
+  vTaskCoreAffinitySet(*handle, 1 << core);
+  return true;
+#endif
+}
 
-      delay(500);
+// the server runs in non-blocking mode in the poll task. the received body
+// is written to the storage by the writer task with a higher priority
+bool WiFiOTAClass::startTasks(TaskFunction_t pollTask, void* ota, int core)
+{
+  if (_ring)
+    return false; // already started
+  _ring = new OTARingBuffer();
+  if (!_ring)
+    return false;
+  bool nonBlocking = _nonBlocking;
+  _nonBlocking = true;
+  TaskHandle_t task;
+  if (createTask(writerTask, "OTA writer", this, OTA_TASK_PRIORITY + 1, core, &_writerTask)) {
+    if (createTask(pollTask, "OTA", ota, OTA_TASK_PRIORITY, core, &task))
+      return true;
+    vTaskDelete(_writerTask); // it waits for a notification
+  }
+  // a task failed to start for lack of memory. the server stays as it was
+  _writerTask = nullptr;
+  delete _ring;
+  _ring = nullptr;
+  _nonBlocking = nonBlocking;
+  return false;
+}
+#endif
 
-      client.stop();
+void WiFiOTAClass::writeBody(const uint8_t* data, size_t length)
+{
+  if (!(_encoding & ENCODING_HEATSHRINK)) {
+    writePatch(data, length);
+    return;
+  }
+  const uint8_t* end = data + length;
+  uint8_t buff[64];
+  size_t l;
+  while ((l = _decoder.decode(data, end, buff, sizeof(buff))) > 0) {
+    writePatch(buff, l);
+  }
+}
+
+// a delta patch or the changed pages are applied after decompression
+void WiFiOTAClass::writePatch(const uint8_t* data, size_t length)
+{
+  if (!(_encoding & (ENCODING_DELTA | ENCODING_PAGES))) {
+    writeImage(data, length);
+    return;
+  }
+  const uint8_t* end = data + length;
+  uint8_t buff[64];
+  size_t l;
+  while ((l = (_encoding & ENCODING_DELTA) ? _deltaDecoder.decode(data, end, buff, sizeof(buff))
+      : _pageDecoder.decode(data, end, buff, sizeof(buff))) > 0) {
+    writeImage(buff, l);
+  }
+}
+
+void WiFiOTAClass::writeImage(const uint8_t* data, size_t length)
+{
+  if (_imageOffset + (long) length <= _uploadLength) { // more data fail the final length check
+    unsigned long t = micros();
+    _storage->write(data, length);
+    _times.write += micros() - t;
+    updateDigests(data, length);
+  }
+  _imageOffset += length;
+}
+
+void WiFiOTAClass::updateDigests(const uint8_t* data, size_t length)
+{
+  if (_digests & DIGEST_CRC32) {
+    _crc32 = crc32(data, length, _crc32);
+  }
+#if OTA_SHA256
+  if (_digests & DIGEST_SHA256) {
+    sha256Update(_sha256, data, length);
+  }
+#endif
+}
+
+// reads the part of the binary stored before the resume into the digests.
+// returns false if the storage can't read it
+bool WiFiOTAClass::hashStoredPart()
+{
+  uint8_t buff[64];
+  for (long offset = 0; offset < _rangeStart; offset += sizeof(buff)) {
+    size_t l = min((long) sizeof(buff), _rangeStart - offset);
+    if (_storage->read(offset, buff, l) != l)
+      return false;
+    updateDigests(buff, l);
+  }
+  return true;
+}
+
+// the digests are of the stored binary, computed while it is written
+bool WiFiOTAClass::checkDigests()
+{
+  if ((_digests & DIGEST_CRC32) && _crc32 != _expectedCrc32)
+    return false;
+#if OTA_SHA256
+  if (_digests & DIGEST_SHA256) {
+    uint8_t hash[32];
+    sha256Finish(_sha256, hash);
+    if (memcmp(hash, _expectedSha256, sizeof(hash)))
+      return false;
+  }
+#endif
+  return true;
+}
+
+void WiFiOTAClass::rejectUpload(Client& client, int code, const char* status)
+{
+  if (_expectContinue) { // the client waits with the body for 100 Continue
+    sendHttpResponse(client, code, status);
+    return;
+  }
+  // the response is sent after the request body is read
+  _responseCode = code;
+  _responseStatus = status;
+  _read = 0;
+  _state = OTA_DISCARD;
+  _bodyStart = millis();
+}
+
+void WiFiOTAClass::discardBody(Client& client)
+{
+  if (_read < _contentLength) {
+    if (client.available()) {
+      byte buff[64];
+      int l = client.read(buff, min((long) sizeof(buff), _contentLength - _read));
+      if (l > 0) {
+        _read += l;
+        _lastDataTime = millis();
+      }
+      if (!timedOut())
+        return;
+    } else if (client.connected() && !timedOut()) {
+      return;
     }
   }
+
+  sendHttpResponse(client, _responseCode, _responseStatus);
 }
 
-void WiFiOTAClass::sendHttpResponse(Client& client, int code, const char* status)
+// counts the printed length or sends the printed text in blocks
+class BufferedPrint : public Print {
+public:
+  BufferedPrint(Client* _client) : client(_client), length(0), index(0) {}
+
+  virtual size_t write(uint8_t c) {
+    length++;
+    if (client) {
+      buffer[index++] = c;
+      if (index == sizeof(buffer)) {
+        send();
+      }
+    }
+    return 1;
+  }
+
+  void send() {
+    if (index == 0)
+      return;
+    client->write(buffer, index);
+    index = 0;
+  }
+
+  Client* client;
+  size_t length;
+  uint8_t buffer[OTA_RESPONSE_BUFFER_SIZE];
+  size_t index;
+};
+
+void WiFiOTAClass::sendHttpResponse(Client& client, int code, const char* status, const char* headers)
 {
   while (client.available()) {
     client.read();
   }
 
-  client.print("HTTP/1.1 ");
-  client.print(code);
-  client.print(" ");
-  client.println(status);
-  client.println("Connection: close");
-  client.println("Content-type: text/plain");
-  client.print("Content-length: ");
-  client.println(strlen(status));
-  client.println();
-  client.print(status);
-  delay(500);
-  client.stop();
+  _responseCode = code;
+  BufferedPrint out(&client);
+  out.print("HTTP/1.1 ");
+  out.print(code);
+  out.print(' ');
+  out.print(status);
+  out.print("\r\nConnection: close\r\nContent-type: text/plain\r\nContent-length: ");
+  out.print(strlen(status));
+  out.print("\r\n");
+  if (headers) {
+    out.print(headers);
+  }
+  out.print("\r\n");
+  if (_method != METHOD_HEAD) {
+    out.print(status);
+  }
+  out.send();
+  closeClient(client);
 
   if (code != 200 && onErrorCallback != nullptr) {
     onErrorCallback(code, status);
   }
 }
 
-void WiFiOTAClass::flushRequestBody(Client& client, long contentLength)
+// the client closes the connection after it reads the response. closing it
+// first could lose the unsent data or reset the connection on some stacks,
+// so pollServer waits for the client in the OTA_CLOSING state
+void WiFiOTAClass::closeClient(Client& client)
 {
-  long read = 0;
+  client.flush();
+  _closeStart = millis();
+  _state = OTA_CLOSING;
+}
 
-  while (client.connected() && read < contentLength) {
-    if (client.available()) {
-      read++;
+void WiFiOTAClass::waitClose(Client& client)
+{
+  while (client.available()) {
+    client.read();
+  }
+  if (client.connected() && millis() - _closeStart < 500)
+    return;
+  client.stop();
+  _state = OTA_IDLE;
+}
+
+void WiFiOTAClass::applyUpdate()
+{
+  unsigned long t = micros();
+  if (beforeApplyCallback) {
+    beforeApplyCallback();
+  }
+  _times.applyDelay = micros() - t;
+  endSession();
+  OTA_TRACE_EVENT(TRACE_APPLY, _uploadLength);
 
-      client.read();
+  // apply the update
+  _storage->apply();
+
+  while (true);
+}
+
+static const int RESPONSE_CODES[] = {0, 200, 400, 401, 404, 408, 409, 411, 413, 414, 415, 416, 422, 431, 500, 501};
+
+void WiFiOTAClass::endSession()
+{
+  if (_scrape) {
+    _metrics.scrapes++;
+  } else {
+    _metrics.sessions++;
+    for (uint8_t i = 0; i < sizeof(RESPONSE_CODES) / sizeof(RESPONSE_CODES[0]); i++) {
+      if (RESPONSE_CODES[i] == _responseCode) {
+        _metrics.responses[i]++;
+        break;
+      }
     }
   }
+  if (onSessionEndCallback) {
+    onSessionEndCallback(_responseCode, _times);
+  }
+}
+
+// the text is printed twice to get the Content-Length without allocating a buffer
+void WiFiOTAClass::sendText(Client& client, const char* contentType, void (WiFiOTAClass::*print)(Print&))
+{
+  BufferedPrint counter(nullptr);
+  (this->*print)(counter);
+  _responseCode = 200;
+
+  BufferedPrint out(&client);
+  out.print("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: ");
+  out.print(contentType);
+  out.print("\r\nContent-Length: ");
+  out.print(counter.length);
+  out.print("\r\n\r\n");
+  (this->*print)(out);
+  out.send();
+  closeClient(client);
 }
 
+static void printMetric(Print& out, const char* name, const char* type, uint32_t value)
+{
+  out.print("# TYPE ");
+  out.print(name);
+  out.print(' ');
+  out.print(type);
+  out.print('\n');
+  out.print(name);
+  out.print(' ');
+  out.print(value);
+  out.print('\n');
+}
+
+static void printSeconds(Print& out, const char* name, const char* type, uint32_t ms)
+{
+  out.print("# TYPE ");
+  out.print(name);
+  out.print(' ');
+  out.print(type);
+  out.print('\n');
+  out.print(name);
+  out.print(' ');
+  out.print(ms / 1000.0, 3);
+  out.print('\n');
+}
+
+// Prometheus text format, lines end with a bare LF
+void WiFiOTAClass::printMetrics(Print& out)
+{
+  printMetric(out, "ota_sessions_total", "counter", _metrics.sessions);
+  printMetric(out, "ota_scrapes_total", "counter", _metrics.scrapes);
+  printMetric(out, "ota_received_bytes_total", "counter", _metrics.receivedBytes);
+  out.print("# TYPE ota_responses_total counter\n");
+  for (uint8_t i = 0; i < sizeof(RESPONSE_CODES) / sizeof(RESPONSE_CODES[0]); i++) {
+    out.print("ota_responses_total{code=\"");
+    out.print(RESPONSE_CODES[i]); // 0 is a session ended without response
+    out.print("\"} ");
+    out.print(_metrics.responses[i]);
+    out.print('\n');
+  }
+  printSeconds(out, "ota_receive_seconds_total", "counter", _metrics.receiveTime);
+  printSeconds(out, "ota_receive_seconds_max", "gauge", _metrics.maxReceiveTime);
+  printSeconds(out, "ota_open_seconds_total", "counter", _metrics.openTime);
+  printSeconds(out, "ota_write_seconds_total", "counter", _metrics.writeTime);
+  printSeconds(out, "ota_erase_seconds_total", "counter", _metrics.eraseTime);
+  printMetric(out, "ota_mdns_responses_total", "counter", _metrics.mdnsResponses);
+  printMetric(out, "ota_mdns_suppressed_total", "counter", _metrics.mdnsSuppressed);
+  printMetric(out, "ota_last_throughput_bytes_per_second", "gauge", _metrics.lastThroughput);
+}
+
+#if OTA_TRACE
+void WiFiOTAClass::printTrace(Print& out)
+{
+  otaTraceDump(out);
+}
+#endif
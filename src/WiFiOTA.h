@@ -31,6 +31,87 @@
 #include <Udp.h>
 
 #include "OTAStorage.h"
+#include "utility/heatshrink.h"
+#include "utility/delta.h"
+#include "utility/pages.h"
+#include "utility/crc32.h"
+#include "utility/sha256.h"
+#include "utility/trace.h"
+#include "utility/mdns.h"
+
+#ifndef OTA_MAX_HEADER_SIZE
+#define OTA_MAX_HEADER_SIZE 1024
+#endif
+
+#ifndef OTA_RECEIVE_READS // the most reads of the client to fill the receive buffer of the body
+#define OTA_RECEIVE_READS 64
+#endif
+
+#ifndef OTA_RECEIVE_READS_NON_BLOCKING // the most reads in one poll() of the non-blocking mode
+#define OTA_RECEIVE_READS_NON_BLOCKING (OTA_RECEIVE_READS < 4 ? OTA_RECEIVE_READS : 4)
+#endif
+
+#ifndef OTA_RESPONSE_BUFFER_SIZE // a response is sent with one write if it fits
+#ifdef __AVR__
+#define OTA_RESPONSE_BUFFER_SIZE 64
+#else
+#define OTA_RESPONSE_BUFFER_SIZE 160
+#endif
+#endif
+
+#ifndef OTA_SHA256 // verification of the X-OTA-SHA256 header
+#ifdef __AVR__
+#define OTA_SHA256 0
+#else
+#define OTA_SHA256 1
+#endif
+#endif
+
+#ifndef OTA_TASK // the upload server can run in FreeRTOS tasks
+#if defined(ESP32) || (defined(ARDUINO_ARCH_RP2040) && defined(__FREERTOS))
+#define OTA_TASK 1
+#else
+#define OTA_TASK 0
+#endif
+#endif
+
+#if OTA_TASK
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
+#include "utility/ring.h"
+
+#ifndef OTA_TASK_CORE // default core of startTask(). not the core of loop()
+#ifdef ESP32
+#define OTA_TASK_CORE 0
+#else
+#define OTA_TASK_CORE 1
+#endif
+#endif
+
+#ifndef OTA_TASK_PRIORITY // of the server task. the writer task has one more
+#define OTA_TASK_PRIORITY 1
+#endif
+
+#ifndef OTA_TASK_STACK_SIZE // in bytes
+#define OTA_TASK_STACK_SIZE 6144
+#endif
+#endif
+
+// durations of the phases of an upload session in microseconds
+struct OTASessionTimes {
+  unsigned long headers; // receiving and parsing the request headers, including the authorization
+  unsigned long open; // open() or resume() of the storage, including the erase in some storages and the read back for the digests
+  unsigned long body; // receiving the body, including the time in write()
+  unsigned long write; // in write() of the storage, mostly flash programming
+  unsigned long erase; // erasing the flash in write() and close(), a part of their times
+  unsigned long close; // close() or suspend() of the storage
+  unsigned long applyDelay; // the beforeApply callback before apply()
+};
 
 class WiFiOTAClass {
 protected:
@@ -39,7 +120,14 @@ protected:
   void begin(IPAddress& localIP, const char* name, const char* password, OTAStorage& storage);
 
   void pollMdns(UDP &mdnsSocket);
+  void sendMdnsGoodbye(UDP &mdnsSocket);
   void pollServer(Client& client);
+  bool isSessionActive() {
+    return _state != OTA_IDLE;
+  }
+#if OTA_TASK
+  bool startTasks(TaskFunction_t pollTask, void* ota, int core);
+#endif
 
 public:
   void beforeApply(void (*fn)(void)) {
@@ -54,21 +142,226 @@ public:
 	  onStartCallback = fn;
   }
 
+  // called for each received part of the body
+  void onProgress(void (*fn)(unsigned long received, unsigned long total)) {
+    onProgressCallback = fn;
+  }
+
+  // called at the end of a session with the status code of the response (0 if none was sent).
+  // for a successful upload it is called before apply()
+  void onSessionEnd(void (*fn)(int code, const OTASessionTimes& times)) {
+    onSessionEndCallback = fn;
+  }
+
+  // adds a key=value string to the TXT record of the mDNS service,
+  // for example the version of the sketch. board, max_size and ota_features are added by the library
+  void addMdnsTxt(const char* key, const char* value);
+
+  // in non-blocking mode the upload is processed in small steps over many poll() calls
+  void setNonBlocking(bool nonBlocking) {
+    _nonBlocking = nonBlocking;
+  }
+
+  // the request is aborted if no data are received for the idle timeout (default 10 s).
+  // in the body the timeout is extended by the time of receiving 2 kB at the throughput of the body
+  void setIdleTimeout(unsigned long ms) {
+    _idleTimeout = ms;
+  }
+
+  // limit of the duration of the session. 0 (default) is no limit
+  void setSessionTimeout(unsigned long ms) {
+    _sessionTimeout = ms;
+  }
+
 private:
-  void sendHttpResponse(Client& client, int code, const char* status);
-  void flushRequestBody(Client& client, long contentLength);
+  enum {
+    OTA_IDLE,
+    OTA_HEADERS,
+    OTA_BODY,
+    OTA_PAGE_HASHES,
+    OTA_DISCARD,
+    OTA_CLOSING // waiting for the client to close the connection after the response
+  };
+
+  enum {
+    PARSE_METHOD,
+    PARSE_PATH,
+    PARSE_VERSION,
+    PARSE_NAME,
+    PARSE_VALUE
+  };
+
+  enum { // bit flags
+    ENCODING_HEATSHRINK = 1,
+    ENCODING_DELTA = 2,
+    ENCODING_PAGES = 4,
+    ENCODING_UNKNOWN = 0x80
+  };
+
+  enum { // bit flags
+    DIGEST_CRC32 = 1,
+    DIGEST_SHA256 = 2,
+    DIGEST_INVALID = 0x80
+  };
+
+  enum {
+    METHOD_GET,
+    METHOD_POST,
+    METHOD_HEAD,
+    METHOD_OTHER
+  };
+
+  enum { // order of HEADER_NAMES
+    HEADER_CONTENT_LENGTH,
+    HEADER_AUTHORIZATION,
+    HEADER_EXPECT,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_CONTENT_RANGE,
+    HEADER_IMAGE,
+    HEADER_CONTENT_ENCODING,
+    HEADER_DECODED_LENGTH,
+    HEADER_PAGE_SIZE,
+    HEADER_CRC32,
+    HEADER_SHA256,
+    HEADER_OTHER
+  };
+
+  void buildMdnsResponse();
+  void sendMdnsResponse(UDP &mdnsSocket, IPAddress ip, uint16_t port, const byte* id = nullptr);
+  void readHeaders(Client& client);
+  bool parseRequest(char c);
+  void appendToken(char c);
+  bool tokenIs(const char* s);
+  void appendHeaderValue(char c);
+  void endHeaderValue();
+  long parseNumber(const char*& p);
+  void handleRequest(Client& client);
+  void handlePageHashes(Client& client);
+  void readPageHashes(Client& client);
+  void readBody(Client& client);
+  void countEraseTime();
+  int receiveBody(Client& client);
+#if OTA_TASK
+  int receiveBodyToRing(Client& client);
+  static void writerTask(void* ota);
+#endif
+  void writeBody(const uint8_t* data, size_t length);
+  void writePatch(const uint8_t* data, size_t length);
+  void writeImage(const uint8_t* data, size_t length);
+  void updateDigests(const uint8_t* data, size_t length);
+  bool hashStoredPart();
+  bool checkDigests();
+  void rejectUpload(Client& client, int code, const char* status);
+  void discardBody(Client& client);
+  void sendHttpResponse(Client& client, int code, const char* status, const char* headers = nullptr);
+  void closeClient(Client& client);
+  void waitClose(Client& client);
+  void applyUpdate();
+  void endSession();
+  bool sessionTimedOut();
+  bool timedOut();
+  void sendText(Client& client, const char* contentType, void (WiFiOTAClass::*print)(Print&));
+  void printMetrics(Print& out);
+#if OTA_TRACE
+  void printTrace(Print& out);
+#endif
 
 private:
   String _name;
+  String _mdnsTxt; // the TXT strings added with addMdnsTxt
   String _expectedAuthorization;
   OTAStorage* _storage;
   
   uint32_t localIp;
   uint32_t _lastMdnsResponseTime;
+  byte* _mdnsResponse;
+  size_t _mdnsResponseLength;
+  bool _mdnsResponsePending;
+  unsigned long _mdnsResponseTime;
+  uint8_t _mdnsAnnouncements;
+
+  bool _nonBlocking;
+  uint8_t _state;
+  uint8_t _parserState;
+  uint8_t _method;
+  char _path[24];
+  uint8_t _pathLength;
+  char _token[32];
+  uint8_t _tokenLength;
+  uint8_t _header;
+  uint8_t _pendingSpaces;
+  uint16_t _headerSize;
+  uint16_t _valueIndex; // the count of value characters not stored in _token
+  bool _authMatch;
+  bool _authorized;
+  bool _expectContinue;
+  bool _chunked;
+  long _contentLength;
+  long _rangeStart;
+  long _rangeEnd;
+  long _rangeLength;
+  uint32_t _imageId;
+  uint8_t _encoding;
+  long _decodedLength;
+  long _pageSize;
+  uint8_t _digests;
+  uint32_t _expectedCrc32;
+  uint32_t _crc32;
+#if OTA_SHA256
+  uint8_t _expectedSha256[32];
+  Sha256Context _sha256;
+#endif
+  long _uploadLength;
+  long _imageOffset;
+  long _read;
+  bool _dataUpload;
+  bool _scrape; // a GET of /metrics or /trace isn't counted as a session
+  bool _applyUpdate; // when the client closed the connection after the response 200
+  unsigned long _closeStart;
+  int _responseCode;
+  const char* _responseStatus;
+  unsigned long _lastDataTime;
+  unsigned long _sessionStart;
+  unsigned long _bodyStart; // the throughput for the idle timeout is of the received body
+  unsigned long _idleTimeout;
+  unsigned long _sessionTimeout;
+  unsigned long _phaseStart;
+  unsigned long _eraseStart; // eraseTime() of the storage at the start of the body
+  OTASessionTimes _times;
+  HeatshrinkDecoder _decoder;
+  DeltaDecoder _deltaDecoder;
+  PageDecoder _pageDecoder;
+#if OTA_TASK
+  OTARingBuffer* _ring; // between the server task and the writer task
+  TaskHandle_t _writerTask;
+#endif
+
+  // cumulative counters for GET /metrics
+  struct {
+    uint32_t sessions; // without the scrapes
+    uint32_t scrapes; // of /metrics and /trace
+    uint32_t receivedBytes; // of the upload bodies
+    uint32_t responses[16]; // in order of RESPONSE_CODES
+    uint32_t receiveTime; // ms
+    uint32_t maxReceiveTime; // ms
+    uint32_t openTime; // ms
+    uint32_t writeTime; // ms
+    uint32_t eraseTime; // ms
+    uint32_t mdnsResponses;
+    uint32_t mdnsSuppressed; // by a known answer or answered with other queries
+    uint32_t lastThroughput; // bytes per second
+  } _metrics;
+
+  // the interrupted upload which can be resumed
+  uint32_t _resumeImageId;
+  long _resumeLength;
+  long _resumeOffset;
   
   void (*beforeApplyCallback)(void);
   void (*onErrorCallback)(int code, const char*);
   void (*onStartCallback)(void);
+  void (*onProgressCallback)(unsigned long received, unsigned long total);
+  void (*onSessionEndCallback)(int code, const OTASessionTimes& times);
 };
 
 #endif
@@ -0,0 +1,28 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _CRC32_H_INCLUDED
+#define _CRC32_H_INCLUDED
+
+#include <Arduino.h>
+
+// CRC-32 as in zip and zlib. the crc of a previous part can be continued.
+// the function is weak, so it can be replaced with one using a CRC unit of the MCU
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "delta.h"
+
+static const char MAGIC_BYTES[] = "OTAD";
+
+DeltaDecoder::DeltaDecoder() {
+  source = nullptr;
+  state = FAILED;
+}
+
+void DeltaDecoder::begin(const uint8_t* _source, long sourceSize) {
+  source = _source;
+  sourceLength = sourceSize; // the maximum until the header is read
+  state = source ? MAGIC : FAILED;
+  index = 0;
+  count = 0;
+}
+
+size_t DeltaDecoder::decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size) {
+  size_t length = 0;
+  while (length < size) {
+    size_t n = size - length;
+    if (n > count) {
+      n = count;
+    }
+    if (state == COPY) { // doesn't consume input
+      memcpy(out + length, source + offset, n);
+    } else if (state == DATA || state == ADD) {
+      if ((size_t) (end - in) < n) {
+        n = end - in;
+      }
+      if (state == DATA) {
+        memcpy(out + length, in, n);
+      } else {
+        for (size_t i = 0; i < n; i++) {
+          out[length + i] = source[offset + i] + in[i];
+        }
+      }
+      in += n;
+    } else {
+      n = 0;
+    }
+    if (n) {
+      length += n;
+      offset += n;
+      count -= n;
+      if (!count) {
+        state = OPCODE;
+      }
+      continue;
+    }
+
+    if (in == end)
+      return length;
+    if (state == FAILED) { // the rest of the patch is ignored
+      in = end;
+      return length;
+    }
+    uint8_t c = *in++;
+    switch (state) {
+      case MAGIC:
+        if (c != MAGIC_BYTES[index]) {
+          state = FAILED;
+        } else if (++index == 4) {
+          value = 0;
+          shift = 0;
+          state = SOURCE_LENGTH;
+        }
+        break;
+      case SOURCE_LENGTH:
+        if (readNumber(c)) {
+          if (value > sourceLength) {
+            state = FAILED;
+            break;
+          }
+          sourceLength = value;
+          offset = 0; // the received hash
+          index = 0;
+          state = SOURCE_HASH;
+        }
+        break;
+      case SOURCE_HASH:
+        offset |= (uint32_t) c << (8 * index);
+        if (++index == 4) {
+          uint32_t hash = 2166136261UL; // FNV-1a
+          for (uint32_t i = 0; i < sourceLength; i++) {
+            hash = (hash ^ source[i]) * 16777619UL;
+          }
+          state = (hash == offset) ? OPCODE : FAILED;
+        }
+        break;
+      case OPCODE:
+        op = c;
+        value = 0;
+        shift = 0;
+        state = (op <= OP_ADD) ? LENGTH : FAILED;
+        break;
+      case LENGTH:
+        if (readNumber(c)) {
+          count = value;
+          offset = 0;
+          value = 0;
+          shift = 0;
+          state = (op == OP_DATA) ? DATA : OFFSET;
+        }
+        break;
+      case OFFSET:
+        if (readNumber(c)) {
+          offset = value;
+          if (offset > sourceLength || count > sourceLength - offset) {
+            state = FAILED;
+          } else {
+            state = (op == OP_COPY) ? COPY : ADD;
+          }
+        }
+        break;
+    }
+    if (!count && (state == DATA || state == COPY || state == ADD)) {
+      state = OPCODE;
+    }
+  }
+  return length;
+}
+
+// reads a byte of a LEB128 number into value. returns true after the last byte
+bool DeltaDecoder::readNumber(uint8_t c) {
+  if (shift > 28) {
+    state = FAILED;
+    return false;
+  }
+  value |= (uint32_t) (c & 0x7F) << shift;
+  shift += 7;
+  return !(c & 0x80);
+}
@@ -0,0 +1,85 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _DELTA_H_INCLUDED
+#define _DELTA_H_INCLUDED
+
+#include <Arduino.h>
+
+/*
+ * Streaming decoder of a binary patch created with extras/delta/ota-delta.py.
+ * The new binary is built from the patch and the source binary (the running
+ * sketch in memory-mapped flash). The decoder doesn't need a buffer.
+ *
+ * Patch format (numbers are unsigned LEB128):
+ *   "OTAD" <source length> <FNV-1a of the source, 4 bytes little endian>
+ *   commands until the end of the patch:
+ *     0 <length> <bytes>            - the bytes are copied to the output
+ *     1 <length> <offset>           - the source bytes are copied to the output
+ *     2 <length> <offset> <bytes>   - the bytes are added to the source bytes
+ */
+
+class DeltaDecoder {
+public:
+  DeltaDecoder();
+
+  void begin(const uint8_t* source, long sourceSize);
+
+  // decodes the input from `in` to `end` into `out`. returns the count of bytes
+  // in `out` and moves `in` after the consumed input. returns 0 if more input is needed
+  size_t decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size);
+
+  // the patch is invalid or was created for other source binary
+  bool failed() {
+    return state == FAILED;
+  }
+
+private:
+  bool readNumber(uint8_t c);
+
+  enum {
+    MAGIC,
+    SOURCE_LENGTH,
+    SOURCE_HASH,
+    OPCODE,
+    LENGTH,
+    OFFSET,
+    DATA,
+    COPY,
+    ADD,
+    FAILED
+  };
+
+  enum {
+    OP_DATA,
+    OP_COPY,
+    OP_ADD
+  };
+
+  const uint8_t* source;
+  uint32_t sourceLength;
+  uint8_t state;
+  uint8_t op;
+  uint8_t index;
+  uint8_t shift;
+  uint32_t value;
+  uint32_t count;
+  uint32_t offset;
+};
+
+#endif
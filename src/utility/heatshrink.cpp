@@ -0,0 +1,103 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "heatshrink.h"
+
+HeatshrinkDecoder::HeatshrinkDecoder() {
+  window = nullptr;
+}
+
+bool HeatshrinkDecoder::begin() {
+  if (window == nullptr) { // allocated once and kept
+    window = new uint8_t[1 << OTA_HEATSHRINK_WINDOW];
+    if (window == nullptr)
+      return false;
+  }
+  memset(window, 0, 1 << OTA_HEATSHRINK_WINDOW);
+  head = 0;
+  state = TAG_BIT;
+  bitMask = 0;
+  bitCount = 0;
+  bits = 0;
+  backrefCount = 0;
+  return true;
+}
+
+size_t HeatshrinkDecoder::decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size) {
+  size_t length = 0;
+  while (length < size) {
+    if (backrefCount) {
+      uint8_t c = window[(head - backrefIndex) & ((1 << OTA_HEATSHRINK_WINDOW) - 1)];
+      out[length++] = c;
+      push(c);
+      backrefCount--;
+      continue;
+    }
+    int v;
+    switch (state) {
+      case TAG_BIT:
+        v = getBits(1, in, end);
+        if (v < 0)
+          return length;
+        state = v ? LITERAL : BACKREF_INDEX;
+        break;
+      case LITERAL:
+        v = getBits(8, in, end);
+        if (v < 0)
+          return length;
+        out[length++] = v;
+        push(v);
+        state = TAG_BIT;
+        break;
+      case BACKREF_INDEX:
+        v = getBits(OTA_HEATSHRINK_WINDOW, in, end);
+        if (v < 0)
+          return length;
+        backrefIndex = v + 1;
+        state = BACKREF_COUNT;
+        break;
+      case BACKREF_COUNT:
+        v = getBits(OTA_HEATSHRINK_LOOKAHEAD, in, end);
+        if (v < 0)
+          return length;
+        backrefCount = v + 1;
+        state = TAG_BIT;
+        break;
+    }
+  }
+  return length;
+}
+
+// reads the bits MSB first. returns -1 if the input ends before all bits are read
+int HeatshrinkDecoder::getBits(uint8_t count, const uint8_t*& in, const uint8_t* end) {
+  while (bitCount < count) {
+    if (bitMask == 0) {
+      if (in == end)
+        return -1;
+      currentByte = *in++;
+      bitMask = 0x80;
+    }
+    bits = (bits << 1) | ((currentByte & bitMask) ? 1 : 0);
+    bitMask >>= 1;
+    bitCount++;
+  }
+  int v = bits;
+  bits = 0;
+  bitCount = 0;
+  return v;
+}
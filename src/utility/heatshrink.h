@@ -0,0 +1,77 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HEATSHRINK_H_INCLUDED
+#define _HEATSHRINK_H_INCLUDED
+
+#include <Arduino.h>
+
+/*
+ * Streaming decoder of the heatshrink compression format
+ * (https://github.com/atomicobject/heatshrink).
+ * The encoder must use the same window and lookahead size,
+ * for example `heatshrink -e -w 8 -l 4 sketch.bin sketch.bin.hs`.
+ * The decoder uses (1 << OTA_HEATSHRINK_WINDOW) bytes of RAM.
+ */
+
+#ifndef OTA_HEATSHRINK_WINDOW
+#define OTA_HEATSHRINK_WINDOW 8
+#endif
+#ifndef OTA_HEATSHRINK_LOOKAHEAD
+#define OTA_HEATSHRINK_LOOKAHEAD 4
+#endif
+
+class HeatshrinkDecoder {
+public:
+  HeatshrinkDecoder();
+  ~HeatshrinkDecoder() {
+    delete[] window;
+  }
+
+  bool begin();
+
+  // decodes the input from `in` to `end` into `out`. returns the count of bytes
+  // in `out` and moves `in` after the consumed input. returns 0 if more input is needed
+  size_t decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size);
+
+private:
+  int getBits(uint8_t count, const uint8_t*& in, const uint8_t* end);
+  void push(uint8_t c) {
+    window[head & ((1 << OTA_HEATSHRINK_WINDOW) - 1)] = c;
+    head++;
+  }
+
+  enum {
+    TAG_BIT,
+    LITERAL,
+    BACKREF_INDEX,
+    BACKREF_COUNT
+  };
+
+  uint8_t* window;
+  uint16_t head;
+  uint8_t state;
+  uint8_t currentByte;
+  uint8_t bitMask;
+  uint8_t bitCount;
+  uint16_t bits;
+  uint16_t backrefIndex;
+  uint16_t backrefCount;
+};
+
+#endif
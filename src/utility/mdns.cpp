@@ -0,0 +1,248 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mdns.h"
+
+#define TYPE_A 1
+#define TYPE_PTR 12
+#define TYPE_TXT 16
+#define TYPE_SRV 33
+#define TYPE_ANY 255
+#define CLASS_IN 1
+#define CLASS_ANY 255
+#define CLASS_QU 0x8000
+
+// the recognized names, also as the ends of longer names
+enum {
+  NAME_INVALID, // malformed or the end of the packet
+  NAME_OTHER,
+  NAME_ROOT, // the end of every name
+  NAME_LOCAL, // local
+  NAME_TCP, // _tcp.local
+  NAME_SERVICE, // _arduino._tcp.local
+  NAME_INSTANCE, // <instance>._arduino._tcp.local
+  NAME_HOST // <instance>.local
+};
+
+// bits of the labels matched by a label
+#define LABEL_LOCAL 0x01
+#define LABEL_TCP 0x02
+#define LABEL_ARDUINO 0x04
+#define LABEL_INSTANCE 0x08
+
+static uint16_t get16(const uint8_t* p) {
+  return ((uint16_t) p[0] << 8) | p[1];
+}
+
+// the name made of a label and the name following it
+static uint8_t prependLabel(uint8_t label, uint8_t name) {
+  switch (name) {
+    case NAME_ROOT:
+      return (label & LABEL_LOCAL) ? NAME_LOCAL : NAME_OTHER;
+    case NAME_LOCAL:
+      return (label & LABEL_TCP) ? NAME_TCP : (label & LABEL_INSTANCE) ? NAME_HOST : NAME_OTHER;
+    case NAME_TCP:
+      return (label & LABEL_ARDUINO) ? NAME_SERVICE : NAME_OTHER;
+    case NAME_SERVICE:
+      return (label & LABEL_INSTANCE) ? NAME_INSTANCE : NAME_OTHER;
+  }
+  return NAME_OTHER;
+}
+
+int MdnsQuery::read() {
+  if (pos >= length)
+    return -1;
+  int c = in->read();
+  if (c >= 0) {
+    pos++;
+  }
+  return c;
+}
+
+bool MdnsQuery::read16(uint16_t& value) {
+  int h = read();
+  int l = read();
+  value = (h << 8) | l;
+  return l >= 0;
+}
+
+bool MdnsQuery::skip(size_t count) {
+  uint8_t buff[16];
+  while (count > 0 && pos < length) {
+    int l = in->read(buff, min(count, sizeof(buff)));
+    if (l <= 0)
+      return false;
+    pos += l;
+    count -= l;
+  }
+  return count == 0;
+}
+
+// reads a label and returns the bits of the labels it matches. returns -1 at the end of the packet
+int MdnsQuery::readLabel(uint8_t l) {
+  const char* labels[] = {"local", "_tcp", "_arduino", instance};
+  int match = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    if (strlen(labels[i]) == l) {
+      match |= bit(i);
+    }
+  }
+  for (uint8_t j = 0; j < l; j++) {
+    int c = read();
+    if (c < 0)
+      return -1;
+    for (uint8_t i = 0; i < 4; i++) {
+      if ((match & bit(i)) && tolower(c) != tolower(labels[i][j])) {
+        match &= ~bit(i);
+      }
+    }
+  }
+  return match;
+}
+
+// reads the possibly compressed name and returns which of the recognized names it is.
+// the offsets of the recognized names in it are kept for the next compressed names
+uint8_t MdnsQuery::readName() {
+  uint16_t offsets[MDNS_MAX_LABELS];
+  uint8_t labels[MDNS_MAX_LABELS];
+  uint8_t count = 0;
+  bool tooLong = false;
+  uint8_t name;
+  while (true) {
+    uint16_t offset = pos;
+    int c = read();
+    if (c < 0)
+      return NAME_INVALID;
+    if (c == 0) {
+      name = NAME_ROOT;
+      break;
+    }
+    if ((c & 0xC0) == 0xC0) { // a pointer to a previous name ends the name
+      int l = read();
+      if (l < 0)
+        return NAME_INVALID;
+      name = findName(((c & 0x3F) << 8) | l);
+      break;
+    }
+    if (c & 0xC0)
+      return NAME_INVALID;
+    int label = readLabel(c);
+    if (label < 0)
+      return NAME_INVALID;
+    if (count < MDNS_MAX_LABELS) {
+      offsets[count] = offset;
+      labels[count] = label;
+      count++;
+    } else {
+      tooLong = true;
+    }
+  }
+  if (tooLong)
+    return NAME_OTHER;
+  while (count > 0 && name != NAME_OTHER) {
+    count--;
+    name = prependLabel(labels[count], name);
+    if (name != NAME_OTHER && nameCount < MDNS_MAX_NAMES) {
+      names[nameCount].offset = offsets[count];
+      names[nameCount].name = name;
+      nameCount++;
+    }
+  }
+  return name;
+}
+
+uint8_t MdnsQuery::findName(uint16_t offset) {
+  for (uint8_t i = 0; i < nameCount; i++) {
+    if (names[i].offset == offset)
+      return names[i].name;
+  }
+  return NAME_OTHER;
+}
+
+bool MdnsQuery::isQuery(const uint8_t* header) {
+  // QR bit 0, OPCODE 0 and at least one question
+  return (header[2] & 0xF8) == 0 && get16(header + 4) > 0;
+}
+
+bool MdnsQuery::parse(const uint8_t* header, UDP& packet, size_t _length, const char* _instance) {
+  service = false;
+  host = false;
+  unicast = false;
+  knownAnswer = false;
+  truncated = false;
+  if (_length < MDNS_HEADER_SIZE || !isQuery(header))
+    return false;
+  in = &packet;
+  pos = MDNS_HEADER_SIZE;
+  length = _length;
+  instance = _instance;
+  nameCount = 0;
+  truncated = header[2] & 0x02;
+  uint16_t questions = get16(header + 4);
+  uint16_t answers = get16(header + 6);
+
+  // the response is sent by unicast only if all our questions request it (RFC 6762 5.4)
+  bool multicast = false;
+  uint16_t i;
+  for (i = 0; i < questions; i++) {
+    uint8_t name = readName();
+    uint16_t type;
+    uint16_t cls;
+    if (name == NAME_INVALID || !read16(type) || !read16(cls))
+      break; // truncated or malformed. the parsed questions are valid
+    if ((cls & ~CLASS_QU) != CLASS_IN && (cls & ~CLASS_QU) != CLASS_ANY)
+      continue;
+    if ((type == TYPE_PTR || type == TYPE_ANY) && name == NAME_SERVICE) {
+      service = true;
+    } else if (((type == TYPE_SRV || type == TYPE_TXT || type == TYPE_ANY) && name == NAME_INSTANCE)
+        || ((type == TYPE_A || type == TYPE_ANY) && name == NAME_HOST)) {
+      host = true;
+    } else {
+      continue;
+    }
+    if (!(cls & CLASS_QU)) {
+      multicast = true;
+    }
+  }
+  unicast = (service || host) && !multicast;
+  if (i < questions || !service)
+    return true;
+
+  // known-answer suppression (RFC 6762 7.1)
+  for (i = 0; i < answers; i++) {
+    uint8_t name = readName();
+    uint16_t type;
+    uint16_t cls;
+    uint16_t ttlHigh;
+    uint16_t ttlLow;
+    uint16_t rdLength;
+    if (name == NAME_INVALID || !read16(type) || !read16(cls) || !read16(ttlHigh) || !read16(ttlLow) || !read16(rdLength))
+      break;
+    uint32_t ttl = ((uint32_t) ttlHigh << 16) | ttlLow;
+    size_t end = pos + rdLength;
+    if (end > length)
+      break;
+    if (type == TYPE_PTR && ttl >= MDNS_TTL / 2 && name == NAME_SERVICE && readName() == NAME_INSTANCE) {
+      knownAnswer = true;
+      break;
+    }
+    if (pos > end || !skip(end - pos))
+      break;
+  }
+  return true;
+}
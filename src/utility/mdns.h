@@ -0,0 +1,76 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _MDNS_H_INCLUDED
+#define _MDNS_H_INCLUDED
+
+#include <Arduino.h>
+#include <Udp.h>
+
+/*
+ * Parser of the mDNS queries (RFC 6762) for the _arduino._tcp service,
+ * the service instance <name>._arduino._tcp.local and the host <name>.local.
+ * The header is checked first, so responses and other packets are
+ * rejected without reading the rest of the packet.
+ * The rest is read from the UDP socket without a copy of the packet.
+ * The labels of a name are compared while they are read and the offsets
+ * of the recognized names are kept for the compressed names, which point
+ * back to them. A name with more than MDNS_MAX_LABELS labels doesn't match.
+ */
+
+#define MDNS_SERVICE "_arduino._tcp.local"
+#define MDNS_TTL 4500 // of the PTR record in the response
+#define MDNS_HEADER_SIZE 12
+#define MDNS_MAX_LABELS 8 // of a name
+#define MDNS_MAX_NAMES 12 // recognized names for the compressed names
+
+class MdnsQuery {
+public:
+  // checks the flags and the count of questions in the header
+  static bool isQuery(const uint8_t* header);
+
+  // parses the questions and the known answers of a query. the header is already read
+  // from the packet of `length` bytes. returns false if the packet is not a query
+  bool parse(const uint8_t* header, UDP& packet, size_t length, const char* instance);
+
+  bool service; // the PTR question for the service was asked
+  bool host; // a question for the instance (SRV, TXT) or the host (A) was asked
+  bool unicast; // all these questions have the QU bit (unicast response requested)
+  bool knownAnswer; // the query has our PTR record with at least half of the TTL
+  bool truncated; // more known answers follow in the next packets
+
+private:
+  int read();
+  bool read16(uint16_t& value);
+  bool skip(size_t count);
+  int readLabel(uint8_t length);
+  uint8_t readName();
+  uint8_t findName(uint16_t offset);
+
+  UDP* in;
+  size_t pos; // in the packet
+  size_t length; // of the packet
+  const char* instance;
+  struct {
+    uint16_t offset;
+    uint8_t name;
+  } names[MDNS_MAX_NAMES];
+  uint8_t nameCount;
+};
+
+#endif
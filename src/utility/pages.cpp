@@ -0,0 +1,107 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "pages.h"
+#include "crc32.h"
+
+PageDecoder::PageDecoder() {
+  compared = false;
+}
+
+bool PageDecoder::beginCompare(const uint8_t* _source, long _sourceSize, long _length, uint16_t _pageSize) {
+  compared = false;
+  if (_pageSize == 0 || (_length + _pageSize - 1) / _pageSize > OTA_MAX_PAGES)
+    return false;
+  source = _source;
+  sourceSize = _sourceSize;
+  length = _length;
+  pageSize = _pageSize;
+  pageCount = (length + pageSize - 1) / pageSize;
+  memset(bitmap, 0, sizeof(bitmap));
+  page = 0;
+  hashIndex = 0;
+  hash = 0;
+  return true;
+}
+
+void PageDecoder::compare(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size && page < pageCount; i++) {
+    hash |= (uint32_t) data[i] << (8 * hashIndex);
+    if (++hashIndex < 4)
+      continue;
+    long start = (long) page * pageSize;
+    long end = (start + pageSize < length) ? start + pageSize : length;
+    if (end > sourceSize || crc32(source + start, end - start) != hash) {
+      bitmap[page / 8] |= 1 << (page % 8);
+    }
+    page++;
+    hashIndex = 0;
+    hash = 0;
+  }
+  compared = (page == pageCount);
+}
+
+void PageDecoder::printBitmap(char* buffer, size_t size) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  size_t l = 0;
+  for (uint16_t i = 0; i < (pageCount + 7) / 8 && l + 2 < size; i++) {
+    buffer[l++] = HEX_DIGITS[bitmap[i] >> 4];
+    buffer[l++] = HEX_DIGITS[bitmap[i] & 0x0F];
+  }
+  buffer[l] = 0;
+}
+
+bool PageDecoder::begin(long _length, long _offset) {
+  if (!compared || _length != length || _offset > length)
+    return false;
+  offset = _offset;
+  return true;
+}
+
+size_t PageDecoder::decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size) {
+  size_t l = 0;
+  while (l < size) {
+    size_t n = size - l;
+    bool changed = true; // data after the end are passed to fail the final length check
+    if (offset < length) {
+      uint16_t p = offset / pageSize;
+      long pageEnd = (long) (p + 1) * pageSize;
+      if (pageEnd > length) {
+        pageEnd = length;
+      }
+      if ((long) n > pageEnd - offset) {
+        n = pageEnd - offset;
+      }
+      changed = isChanged(p);
+    }
+    if (changed) {
+      if (in == end)
+        break;
+      if (n > (size_t) (end - in)) {
+        n = end - in;
+      }
+      memcpy(out + l, in, n);
+      in += n;
+    } else { // unchanged page from the source
+      memcpy(out + l, source + offset, n);
+    }
+    offset += n;
+    l += n;
+  }
+  return l;
+}
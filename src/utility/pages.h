@@ -0,0 +1,81 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PAGES_H_INCLUDED
+#define _PAGES_H_INCLUDED
+
+#include <Arduino.h>
+
+/*
+ * Upload of only the changed pages of a new binary.
+ * The client sends the CRC-32 of each page of the new binary. The pages
+ * are compared with the source binary (the running sketch in memory-mapped
+ * flash) and the client gets a bitmap of the changed pages. Then the client
+ * sends only the changed pages and the decoder fills in the unchanged pages
+ * from the source binary.
+ * The bitmap uses OTA_MAX_PAGES / 8 bytes of RAM.
+ */
+
+#ifndef OTA_MAX_PAGES
+#if defined(__AVR__) || defined(ESP8266) || defined(ESP32)
+#define OTA_MAX_PAGES 8 // not supported
+#else
+#define OTA_MAX_PAGES 1024
+#endif
+#endif
+
+class PageDecoder {
+public:
+  PageDecoder();
+
+  // starts the comparison of the pages of a new binary with the source binary.
+  // returns false if the binary has more than OTA_MAX_PAGES pages
+  bool beginCompare(const uint8_t* source, long sourceSize, long length, uint16_t pageSize);
+
+  // reads CRC-32 values (little endian) of the next pages
+  void compare(const uint8_t* data, size_t size);
+
+  // the bitmap of changed pages as hex string. bit 0 of the first byte is the first page
+  void printBitmap(char* buffer, size_t size);
+
+  // starts the upload of the changed pages of the compared binary from offset
+  bool begin(long length, long offset);
+
+  // decodes the input from `in` to `end` into `out`. returns the count of bytes
+  // in `out` and moves `in` after the consumed input. returns 0 if more input is needed
+  size_t decode(const uint8_t*& in, const uint8_t* end, uint8_t* out, size_t size);
+
+private:
+  bool isChanged(uint16_t page) {
+    return bitmap[page / 8] & (1 << (page % 8));
+  }
+
+  uint8_t bitmap[(OTA_MAX_PAGES + 7) / 8];
+  const uint8_t* source;
+  long sourceSize;
+  long length;
+  uint16_t pageSize;
+  uint16_t pageCount;
+  uint16_t page;
+  uint8_t hashIndex;
+  uint32_t hash;
+  bool compared;
+  long offset;
+};
+
+#endif
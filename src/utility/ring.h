@@ -0,0 +1,84 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _RING_H_INCLUDED
+#define _RING_H_INCLUDED
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+ * Single-producer single-consumer ring buffer between the task receiving
+ * the upload and the task writing it to the storage. The producer reads
+ * from the client directly into the free space and the consumer writes
+ * to the storage directly from the buffer, so the data are not copied.
+ * The indexes run freely and each is changed by one task only.
+ */
+
+#ifndef OTA_TASK_RING_SIZE
+#define OTA_TASK_RING_SIZE 4096
+#endif
+
+class OTARingBuffer {
+public:
+  static_assert((OTA_TASK_RING_SIZE & (OTA_TASK_RING_SIZE - 1)) == 0, "OTA_TASK_RING_SIZE must be a power of 2");
+
+  static const size_t SIZE = OTA_TASK_RING_SIZE;
+
+  OTARingBuffer() : head(0), tail(0) {}
+
+  // the contiguous free space for the producer
+  size_t writable(uint8_t*& p) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t free = SIZE - (h - tail.load(std::memory_order_acquire));
+    size_t i = h % SIZE;
+    p = buffer + i;
+    return min(free, SIZE - i);
+  }
+
+  // makes `length` bytes written to the free space available to the consumer
+  void commit(size_t length) {
+    head.store(head.load(std::memory_order_relaxed) + length, std::memory_order_release);
+  }
+
+  // the contiguous data for the consumer
+  size_t readable(const uint8_t*& p) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t used = head.load(std::memory_order_acquire) - t;
+    size_t i = t % SIZE;
+    p = buffer + i;
+    return min(used, SIZE - i);
+  }
+
+  // frees `length` bytes processed by the consumer
+  void consume(size_t length) {
+    tail.store(tail.load(std::memory_order_relaxed) + length, std::memory_order_release);
+  }
+
+  // true if the consumer processed all data
+  bool empty() {
+    return tail.load(std::memory_order_acquire) == head.load(std::memory_order_relaxed);
+  }
+
+private:
+  uint8_t buffer[SIZE];
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+};
+
+#endif
@@ -71,23 +71,38 @@ void __no_inline_not_in_flash_func(copy_flash_pages)(uint32_t flash_offs, const
 
     __compiler_memory_barrier();
 
-    connect_internal_flash();
-    flash_exit_xip();
-    flash_range_erase(flash_offs, count, FLASH_BLOCK_SIZE, FLASH_BLOCK_ERASE_CMD);
-    flash_flush_cache();
-    flash_enable_xip_via_boot2();
-
     uint8_t buff[FLASH_PAGE_SIZE];
     while (count) {
-      memcpy_fast(buff, (char*) data, FLASH_PAGE_SIZE);
-      connect_internal_flash();
-      flash_exit_xip();
-      flash_range_program(flash_offs, buff, FLASH_PAGE_SIZE);
-      flash_flush_cache();
-      flash_enable_xip_via_boot2();
-      flash_offs += FLASH_PAGE_SIZE;
-      data += FLASH_PAGE_SIZE;
-      count -= FLASH_PAGE_SIZE;
+      // unchanged sectors are skipped
+      const uint32_t* s = (const uint32_t*) data;
+      const uint32_t* d = (const uint32_t*) (XIP_BASE + flash_offs);
+      uint32_t i = 0;
+      while (i < FLASH_SECTOR_SIZE / 4 && d[i] == s[i]) {
+        i++;
+      }
+      if (i < FLASH_SECTOR_SIZE / 4) {
+        connect_internal_flash();
+        flash_exit_xip();
+        flash_range_erase(flash_offs, FLASH_SECTOR_SIZE, FLASH_BLOCK_SIZE, FLASH_BLOCK_ERASE_CMD);
+        flash_flush_cache();
+        flash_enable_xip_via_boot2();
+
+        for (uint32_t page = 0; page < FLASH_SECTOR_SIZE; page += FLASH_PAGE_SIZE) {
+          memcpy_fast(buff, (uint8_t*) data + page, FLASH_PAGE_SIZE);
+          // blank pages are not programmed
+          for (i = 0; i < FLASH_PAGE_SIZE && buff[i] == 0xFF; i++);
+          if (i == FLASH_PAGE_SIZE)
+            continue;
+          connect_internal_flash();
+          flash_exit_xip();
+          flash_range_program(flash_offs + page, buff, FLASH_PAGE_SIZE);
+          flash_flush_cache();
+          flash_enable_xip_via_boot2();
+        }
+      }
+      flash_offs += FLASH_SECTOR_SIZE;
+      data += FLASH_SECTOR_SIZE;
+      count -= FLASH_SECTOR_SIZE;
     }
     if (reset) {
       watchdog_reboot(0, 0, 0);
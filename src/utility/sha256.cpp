@@ -0,0 +1,108 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sha256.h"
+
+static const uint32_t K[64] PROGMEM = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, uint8_t n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static void transform(Sha256Context& ctx) {
+  uint32_t w[16];
+  for (uint8_t i = 0; i < 16; i++) {
+    w[i] = ((uint32_t) ctx.buffer[i * 4] << 24) | ((uint32_t) ctx.buffer[i * 4 + 1] << 16)
+        | ((uint32_t) ctx.buffer[i * 4 + 2] << 8) | ctx.buffer[i * 4 + 3];
+  }
+  uint32_t a = ctx.state[0], b = ctx.state[1], c = ctx.state[2], d = ctx.state[3];
+  uint32_t e = ctx.state[4], f = ctx.state[5], g = ctx.state[6], h = ctx.state[7];
+  for (uint8_t i = 0; i < 64; i++) {
+    if (i >= 16) { // the message schedule in a ring of 16 words
+      uint32_t w1 = w[(i + 1) & 15];
+      uint32_t w14 = w[(i + 14) & 15];
+      w[i & 15] += (ror(w1, 7) ^ ror(w1, 18) ^ (w1 >> 3)) + w[(i + 9) & 15]
+          + (ror(w14, 17) ^ ror(w14, 19) ^ (w14 >> 10));
+    }
+    uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + pgm_read_dword(&K[i]) + w[i & 15];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  ctx.state[0] += a;
+  ctx.state[1] += b;
+  ctx.state[2] += c;
+  ctx.state[3] += d;
+  ctx.state[4] += e;
+  ctx.state[5] += f;
+  ctx.state[6] += g;
+  ctx.state[7] += h;
+}
+
+static void addByte(Sha256Context& ctx, uint8_t b) {
+  ctx.buffer[ctx.length % 64] = b;
+  ctx.length++;
+  if (ctx.length % 64 == 0) {
+    transform(ctx);
+  }
+}
+
+__attribute__((weak)) void sha256Begin(Sha256Context& ctx) {
+  static const uint32_t H[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  memcpy(ctx.state, H, sizeof(H));
+  ctx.length = 0;
+}
+
+__attribute__((weak)) void sha256Update(Sha256Context& ctx, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    addByte(ctx, data[i]);
+  }
+}
+
+__attribute__((weak)) void sha256Finish(Sha256Context& ctx, uint8_t hash[32]) {
+  uint32_t length = ctx.length;
+  addByte(ctx, 0x80);
+  while (ctx.length % 64 != 56) {
+    addByte(ctx, 0);
+  }
+  // the length in bits as 64 bit big endian number
+  uint8_t bits[8] = {0, 0, 0, (uint8_t) (length >> 29), (uint8_t) (length >> 21), (uint8_t) (length >> 13), (uint8_t) (length >> 5), (uint8_t) (length << 3)};
+  for (uint8_t i = 0; i < 8; i++) {
+    addByte(ctx, bits[i]);
+  }
+  for (uint8_t i = 0; i < 32; i++) {
+    hash[i] = ctx.state[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
@@ -0,0 +1,40 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _SHA256_H_INCLUDED
+#define _SHA256_H_INCLUDED
+
+#include <Arduino.h>
+
+/*
+ * SHA-256 in software. The functions are weak, so they can be replaced
+ * with functions using a hash engine of the MCU. A replacement can keep
+ * its state in the context or in the engine.
+ */
+
+struct Sha256Context {
+  uint32_t state[8];
+  uint32_t length; // in bytes
+  uint8_t buffer[64];
+};
+
+void sha256Begin(Sha256Context& ctx);
+void sha256Update(Sha256Context& ctx, const uint8_t* data, size_t length);
+void sha256Finish(Sha256Context& ctx, uint8_t hash[32]);
+
+#endif
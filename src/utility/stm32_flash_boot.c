@@ -37,63 +37,80 @@
  * note: interrupts must be disabled.
  * note: parameters must be multiple of FLASH_PAGE_SIZE
  * note: for models with sectors, flash_offs must be start address of a sector
+ * unchanged pages or sectors are not erased and blank half-words are not written
  */
 void copy_flash_pages(uint32_t flash_offs, const uint8_t *data, uint32_t count, uint8_t reset) {
 
-  uint32_t page_address = flash_offs;
   while (FLASH->SR & FLASH_SR_BSY);
 
+  while (count) {
+#ifdef FLASH_PAGE_SIZE
+    uint32_t size = FLASH_PAGE_SIZE;
+#else
+    uint32_t offs = flash_offs - FLASH_BASE;
+    uint32_t size;
+    uint8_t sector;
+    if (offs < 4 * SMALL_SECTOR_SIZE) {
+      sector = offs / SMALL_SECTOR_SIZE;
+      size = SMALL_SECTOR_SIZE;
+    } else if (offs < 8 * SMALL_SECTOR_SIZE) { // size of sector 4 is (4 * SMALL_SECTOR_SIZE)
+      sector = 4;
+      size = 4 * SMALL_SECTOR_SIZE;
+    } else {
+      sector = 5 + (offs - 8 * SMALL_SECTOR_SIZE) / LARGE_SECTOR_SIZE;
+      size = LARGE_SECTOR_SIZE;
+    }
+#endif
+    if (size > count) {
+      size = count;
+    }
+
+    // unchanged pages or sectors are skipped
+    const uint16_t* ptr = (const uint16_t*) data;
+    uint32_t i = 0;
+    while (i < size / 2 && *(volatile uint16_t*)(flash_offs + 2 * i) == ptr[i]) {
+      i++;
+    }
+    if (i < size / 2) {
 #ifdef FLASH_CR_PSIZE
-  CLEAR_BIT(FLASH->CR, FLASH_CR_PSIZE);
-  FLASH->CR |= 0x00000200U; // FLASH_PSIZE_WORD;
-  FLASH->CR |= FLASH_CR_PG;
+      CLEAR_BIT(FLASH->CR, FLASH_CR_PSIZE);
+      FLASH->CR |= 0x00000200U; // FLASH_PSIZE_WORD;
+      FLASH->CR |= FLASH_CR_PG;
 #endif
 #ifdef FLASH_PAGE_SIZE
-  SET_BIT(FLASH->CR, FLASH_CR_PER);
-  for (uint16_t i = 0; i < count / FLASH_PAGE_SIZE; i++) {
-    WRITE_REG(FLASH->AR, page_address);
-    SET_BIT(FLASH->CR, FLASH_CR_STRT);
-    page_address += FLASH_PAGE_SIZE;
-    while (FLASH->SR & FLASH_SR_BSY);
-  }
-  CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
+      SET_BIT(FLASH->CR, FLASH_CR_PER);
+      WRITE_REG(FLASH->AR, flash_offs);
+      SET_BIT(FLASH->CR, FLASH_CR_STRT);
+      while (FLASH->SR & FLASH_SR_BSY);
+      CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
 #else
-  uint8_t startSector = (flash_offs == FLASH_BASE) ? 0 : 1; // 1 if bootloader is in sector 0
-  uint8_t endSector = 1 + startSector + ((count - 1) / SMALL_SECTOR_SIZE); // size of the first 4 sectors is 0x4000 kB
-  if (endSector > 4) { // if more than 4 sectors are needed (including bootloader)
-    if (endSector < 8) { // size of sector 4 is (4 * SMALL_SECTOR_SIZE)
-      endSector = 5;
-    } else { // let's divide with the count of large sectors and add the first 5 sectors as one large sector
-      endSector = 5 + (((count - 1) + (startSector * SMALL_SECTOR_SIZE)) / LARGE_SECTOR_SIZE);
-    }
-  }
-  for (uint8_t sector = startSector; sector < endSector; sector++) {
-    CLEAR_BIT(FLASH->CR, FLASH_CR_SNB);
-    FLASH->CR |= FLASH_CR_SER | (sector << FLASH_CR_SNB_Pos);
-    FLASH->CR |= FLASH_CR_STRT;
-    while (FLASH->SR & FLASH_SR_BSY);
-  }
-  CLEAR_BIT(FLASH->CR, (FLASH_CR_SER | FLASH_CR_SNB));
+      CLEAR_BIT(FLASH->CR, FLASH_CR_SNB);
+      FLASH->CR |= FLASH_CR_SER | (sector << FLASH_CR_SNB_Pos);
+      FLASH->CR |= FLASH_CR_STRT;
+      while (FLASH->SR & FLASH_SR_BSY);
+      CLEAR_BIT(FLASH->CR, (FLASH_CR_SER | FLASH_CR_SNB));
 #endif
 
-  page_address = flash_offs;
-  uint16_t* ptr = (uint16_t*) data;
-  while (FLASH->SR & FLASH_SR_BSY);
 #ifdef FLASH_CR_PSIZE
-  CLEAR_BIT(FLASH->CR, FLASH_CR_PSIZE);
-  FLASH->CR |= 0x00000100U; // FLASH_PSIZE_HALF_WORD
-  FLASH->CR |= FLASH_CR_PG;
+      CLEAR_BIT(FLASH->CR, FLASH_CR_PSIZE);
+      FLASH->CR |= 0x00000100U; // FLASH_PSIZE_HALF_WORD
+      FLASH->CR |= FLASH_CR_PG;
 #else
-  SET_BIT(FLASH->CR, FLASH_CR_PG);
+      SET_BIT(FLASH->CR, FLASH_CR_PG);
 #endif
-  while (count) {
-    *(volatile uint16_t*)page_address = *ptr;
-    page_address += 2;
-    count -= 2;
-    ptr++;
-    while (FLASH->SR & FLASH_SR_BSY);
+      for (i = 0; i < size / 2; i++) {
+        if (ptr[i] == 0xFFFF) // blank after erase
+          continue;
+        *(volatile uint16_t*)(flash_offs + 2 * i) = ptr[i];
+        while (FLASH->SR & FLASH_SR_BSY);
+      }
+      CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
+    }
+
+    flash_offs += size;
+    data += size;
+    count -= size;
   }
-  CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
 
   if (reset) {
     NVIC_SystemReset();
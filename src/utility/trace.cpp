@@ -0,0 +1,96 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "trace.h"
+
+#if OTA_TRACE
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk) && defined(CoreDebug_DEMCR_TRCENA_Msk)
+#define OTA_TRACE_CYCLES 1
+#else
+#define OTA_TRACE_CYCLES 0
+#endif
+
+struct OTATraceEntry {
+  uint32_t time;
+  uint32_t value;
+  uint8_t event;
+};
+
+static OTATraceEntry entries[OTA_TRACE_SIZE];
+static uint16_t next;
+static bool full;
+
+static const char* const EVENT_NAMES[] = {
+  "accept", "headers", "read", "erase_start", "erase_end", "program_start", "program_end", "apply"
+};
+
+static uint32_t timestamp()
+{
+#if OTA_TRACE_CYCLES
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  return DWT->CYCCNT;
+#else
+  return micros();
+#endif
+}
+
+void otaTrace(uint8_t event, uint32_t value)
+{
+  OTATraceEntry& entry = entries[next];
+  entry.time = timestamp();
+  entry.value = value;
+  entry.event = event;
+  next++;
+  if (next == OTA_TRACE_SIZE) {
+    next = 0;
+    full = true;
+  }
+}
+
+void otaTraceDump(Print& out)
+{
+#if OTA_TRACE_CYCLES
+  out.print("# cycles at ");
+  out.print((unsigned long) SystemCoreClock);
+  out.print(" Hz");
+#else
+  out.print("# microseconds");
+#endif
+  out.print('\n');
+  uint16_t i = full ? next : 0;
+  for (uint16_t n = full ? OTA_TRACE_SIZE : next; n > 0; n--) {
+    const OTATraceEntry& entry = entries[i];
+    out.print((unsigned long) entry.time);
+    out.print(' ');
+    out.print(EVENT_NAMES[entry.event]);
+    out.print(' ');
+    out.print((unsigned long) entry.value);
+    out.print('\n');
+    i++;
+    if (i == OTA_TRACE_SIZE) {
+      i = 0;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+  Copyright (c) 2026 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _OTA_TRACE_H_INCLUDED
+#define _OTA_TRACE_H_INCLUDED
+
+#include <Arduino.h>
+
+// with OTA_TRACE defined as 1 in build flags, events of the upload sessions
+// are recorded in a RAM ring buffer. otherwise OTA_TRACE_EVENT compiles to nothing.
+#ifndef OTA_TRACE
+#define OTA_TRACE 0
+#endif
+
+#ifndef OTA_TRACE_SIZE // count of events in the ring buffer
+#define OTA_TRACE_SIZE 128
+#endif
+
+enum OTATraceEvent {
+  TRACE_ACCEPT, // value is 0
+  TRACE_HEADERS, // value is the Content-Length
+  TRACE_READ, // value is the count of bytes returned by client.read
+  TRACE_ERASE_START, // value is the flash address
+  TRACE_ERASE_END,
+  TRACE_PROGRAM_START, // value is the flash address
+  TRACE_PROGRAM_END,
+  TRACE_APPLY // value is the length of the binary
+};
+
+#if OTA_TRACE
+#define OTA_TRACE_EVENT(event, value) otaTrace(event, value)
+
+// timestamp in CPU cycles if the MCU has the DWT cycle counter, otherwise in microseconds
+void otaTrace(uint8_t event, uint32_t value);
+
+// prints the recorded events from the oldest, one per line
+void otaTraceDump(Print& out);
+#else
+#define OTA_TRACE_EVENT(event, value)
+#endif
+
+#endif